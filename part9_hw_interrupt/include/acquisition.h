@@ -0,0 +1,82 @@
+/*
+Acquisition stage: the SampleSink every sample source feeds.
+
+Packs incoming frames into SampleBlocks in place and hands each full block (window_len() frames, or as
+many as fit) to the processing task through a BlockBuffer. Each on_frames() call that publishes anything
+sends exactly one notification (eSetBits, bit i = block i was published), so a call that completes
+several blocks costs at most one context switch, and the task drains every ready block per wake-up.
+With decimation enabled, every channel first runs through an integer CIC decimator (cic_decimator.h),
+so only one frame per ratio input frames reaches the blocks and the task. A decimated frame takes the
+timestamp of the last input frame it includes.
+Every raw frame also goes through the event detector (event_detector.h) before decimation, so
+threshold and slope events fire on the sample itself rather than when its block is published.
+If the channel count, the decimation fraction bits or the frame period change, or a frame's timestamp
+is too far off the block's nominal grid, the partial block is published early so a block never mixes
+frame layouts or time bases.
+on_frames() works from ISR context (timer source) as well as from task context (I2S reader task,
+simulation). The consumer is woken through a Notifier (notifier.h), so the stage has no FreeRTOS
+dependency and runs on a host behind the simulated source.
+*/
+
+#pragma once
+
+#include <atomic>
+#include "block_buffer.h"
+#include "cic_decimator.h"
+#include "event_detector.h"
+#include "notifier.h"
+#include "sample_source.h"
+
+static const size_t SAMPLE_BLOCK_CNT = 3; // triple buffering: source fills one, task owns one, one spare
+static_assert(SAMPLE_BLOCK_CNT <= 32, "published block indices are sent as notification bits");
+static const OverflowPolicy sample_policy = OverflowPolicy::OverwriteOldest; // keep the newest windows when the task falls behind
+
+class Acquisition : public SampleSink
+{
+public:
+    // Notified with the published block indices. Must be set before the source starts.
+    void begin(Notifier* consumer) { consumer_ = consumer; }
+
+    void on_frames(const sample_t* frames, size_t frame_cnt, uint8_t channels,
+        uint64_t timestamp_us, uint32_t period_ns) override;
+
+    // Change the # of frames per block (1..SAMPLE_BLOCK_MAX) from any task. Blocks hold at most
+    // SAMPLE_BLOCK_MAX samples, so with several channels a block may be published with fewer frames.
+    // Takes effect on the block being filled, so nothing is dropped: a block already longer than the
+    // new window is published as is. Returns 0 on success, -1 if len is out of range.
+    int set_window_len(uint16_t len);
+    uint16_t window_len() const { return window_len_.load(std::memory_order_relaxed); }
+
+    // Decimate every channel by ratio with a CIC of the given order (1 = boxcar), from any task.
+    // ratio 1 disables decimation. The producer picks the change up at its next frame and restarts the
+    // filters. Returns 0 on success, -1 if CicDecimator::check() rejects the pair.
+    int set_decimation(uint16_t ratio, uint8_t order);
+    uint16_t decimation_ratio() const { return decim_cfg_.load(std::memory_order_relaxed) & 0xFFFF; }
+    uint8_t decimation_order() const { return decim_cfg_.load(std::memory_order_relaxed) >> 16; }
+
+    // Consumer side, see BlockBuffer. Drain with ready_count() so an empty queue is not an underrun.
+    SampleBlock* acquire() { return blocks_.acquire(); }
+    size_t ready_count() const { return blocks_.ready_count(); }
+    void release(SampleBlock* block) { blocks_.release(block); }
+
+    // Loss accounting in blocks
+    BufferStats stats() const { return blocks_.stats(); }
+
+    // Rules and event queue of the detector fed by on_frames()
+    EventDetector& detector() { return detector_; }
+
+private:
+    static bool fits_block(const SampleBlock& block, uint8_t channels, uint8_t frac_bits,
+        uint32_t period_ns, uint64_t timestamp_us);
+
+    BlockBuffer<SampleBlock, SAMPLE_BLOCK_CNT, sample_policy> blocks_;
+    Notifier* consumer_ = NULL;
+    std::atomic<uint16_t> window_len_{DEFAULT_WINDOW_LEN};
+
+    // Decimation config requested by set_decimation() (ratio | order << 16) and the one the producer runs
+    std::atomic<uint32_t> decim_cfg_{1 | 1 << 16};
+    uint32_t decim_applied_ = 1 | 1 << 16; // producer owned
+    uint8_t decim_channels_ = 0; // channel count the decimators were restarted for, producer owned
+    CicDecimator decim_[SAMPLE_MAX_CHANNELS]; // producer owned, one per channel
+    EventDetector detector_;
+};
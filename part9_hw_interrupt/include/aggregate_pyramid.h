@@ -0,0 +1,163 @@
+/*
+Multi-resolution aggregates: count, sum, min and max per channel over 1 s, 1 min and 1 h windows.
+
+Frames go into the 1 s level by their hardware timestamp. When a frame falls past the end of the
+current second, that window is closed and folded into the 1 min level, which in turn closes and folds
+into the 1 h level when the folded window belongs to a new minute. So every sample is touched once, each
+level costs O(1) per closed window below it, and memory is two aggregates (current and last completed)
+per level and channel. Windows are aligned to the timestamp clock (multiples of their length), and an
+upper level closes when the first window of its next period arrives from below.
+
+Samples are normalized to FRAC_BITS fraction bits (the most decimation adds), so windows filled with
+and without oversampling can be merged. A change of channel count starts over, and so does switching a
+DC-blocking filter on or off: its output carries a mid-scale offset (see filter_bank.h) that offset()
+reports in the same units, to be subtracted from the sum/count, min and max.
+
+Owned by the consumer task.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "cic_decimator.h"
+#include "sample_block.h"
+
+struct Aggregate
+{
+    uint64_t start_us; // window start, multiple of the level length
+    uint32_t count;
+    uint64_t sum; // in units of 2^-FRAC_BITS ADC counts
+    uint32_t min;
+    uint32_t max;
+
+    void clear()
+    {
+        count = 0;
+        sum = 0;
+        min = UINT32_MAX;
+        max = 0;
+    }
+
+    void merge(const Aggregate& other)
+    {
+        count += other.count;
+        sum += other.sum;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+    }
+};
+
+class AggregatePyramid
+{
+public:
+    static const uint8_t LEVELS = 3;
+    static constexpr uint64_t LEVEL_US[LEVELS] = {1000000ull, 60000000ull, 3600000000ull};
+    static const uint8_t FRAC_BITS = CicDecimator::MAX_EXTRA_BITS;
+
+    AggregatePyramid() { reset(0); }
+
+    // Consumer side
+    void push_block(const SampleBlock& block)
+    {
+        const uint8_t shift = FRAC_BITS - block.frac_bits;
+        const uint32_t offset = (uint32_t)block.offset << shift;
+        if (block.channels != channels_ || offset != offset_)
+        {
+            reset(block.channels);
+            offset_ = offset;
+        }
+
+        const uint16_t frames = block.frames();
+        for (uint16_t f = 0; f < frames; f++)
+        {
+            const uint64_t t = block.timestamp_us(f);
+            if (t >= end_us_)
+            {
+                close(0);
+                const uint64_t start_us = t - t % LEVEL_US[0];
+                for (uint8_t c = 0; c < channels_; c++)
+                {
+                    current_[0][c].start_us = start_us;
+                }
+                end_us_ = start_us + LEVEL_US[0];
+            }
+
+            const sample_t* frame = &block.samples[f * channels_];
+            for (uint8_t c = 0; c < channels_; c++)
+            {
+                Aggregate& agg = current_[0][c];
+                const uint32_t v = (uint32_t)frame[c] << shift;
+                agg.count++;
+                agg.sum += v;
+                agg.min = v < agg.min ? v : agg.min;
+                agg.max = v > agg.max ? v : agg.max;
+            }
+        }
+    }
+
+    uint8_t channels() const { return channels_; }
+    uint32_t offset() const { return offset_; } // in units of 2^-FRAC_BITS ADC counts
+
+    // Last completed window of a level, count 0 if none yet
+    const Aggregate& last(uint8_t level, uint8_t channel) const { return last_[level][channel]; }
+
+    // Window still being filled
+    const Aggregate& current(uint8_t level, uint8_t channel) const { return current_[level][channel]; }
+
+private:
+    void reset(uint8_t channels)
+    {
+        channels_ = channels;
+        end_us_ = 0;
+        for (uint8_t l = 0; l < LEVELS; l++)
+        {
+            for (uint8_t c = 0; c < SAMPLE_MAX_CHANNELS; c++)
+            {
+                current_[l][c].clear();
+                current_[l][c].start_us = 0;
+                last_[l][c].clear();
+                last_[l][c].start_us = 0;
+            }
+        }
+    }
+
+    // Complete the current window of level, fold it into the level above and start an empty one
+    void close(uint8_t level)
+    {
+        if (current_[level][0].count == 0)
+        {
+            return;
+        }
+
+        const uint64_t start_us = current_[level][0].start_us;
+        if (level + 1 < LEVELS)
+        {
+            const uint64_t upper_start = start_us - start_us % LEVEL_US[level + 1];
+            if (current_[level + 1][0].count != 0 && current_[level + 1][0].start_us != upper_start)
+            {
+                close(level + 1);
+            }
+        }
+
+        for (uint8_t c = 0; c < channels_; c++)
+        {
+            last_[level][c] = current_[level][c];
+            if (level + 1 < LEVELS)
+            {
+                Aggregate& upper = current_[level + 1][c];
+                if (upper.count == 0)
+                {
+                    upper.start_us = start_us - start_us % LEVEL_US[level + 1];
+                }
+                upper.merge(current_[level][c]);
+            }
+            current_[level][c].clear();
+        }
+    }
+
+    uint8_t channels_;
+    uint32_t offset_ = 0; // of every window
+    uint64_t end_us_; // end of the current 1 s window
+    Aggregate current_[LEVELS][SAMPLE_MAX_CHANNELS];
+    Aggregate last_[LEVELS][SAMPLE_MAX_CHANNELS];
+};
@@ -0,0 +1,141 @@
+/*
+Zero-copy block handoff between a producer (ISR) and a consumer task (double/triple buffering).
+
+The producer fills one block in place. When it is full, publish() hands the whole block to the consumer
+and switches to the next free block. The consumer acquire()s ready blocks, works on them directly and
+release()s them back to the producer. Ownership of every block is always exactly one of:
+- the producer's write block,
+- queued in ready_ (published, waiting for the consumer),
+- held by the consumer (acquired),
+- queued in free_ (released, waiting for the producer).
+Block indices move between the two sides through RingBuffers, so a block is never visible to the
+consumer while the producer can still write to it, and vice versa.
+
+When the consumer falls behind, publish() finds no free block to switch to and applies the overflow
+policy (see buffer_policy.h), counted in whole blocks:
+- DropNewest: the just-filled block is discarded and refilled.
+- OverwriteOldest: the oldest block still waiting in ready_ is reclaimed for writing. ready_ pops are
+  CAS-based under this policy, so producer and consumer can never both take the same block.
+- Backpressure: the filled block is kept and publish() fails. write_block() returns NULL until a later
+  publish() succeeds, so the producer knows to skip work instead of losing data.
+
+Block must provide reset(), which is called when the producer takes a block to fill.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "buffer_policy.h"
+#include "ring_buffer.h"
+
+template <typename Block, size_t N, OverflowPolicy P = OverflowPolicy::DropNewest>
+class BlockBuffer
+{
+    static_assert(N >= 2 && N <= 128, "BlockBuffer needs at least two blocks");
+
+public:
+    static constexpr size_t BLOCK_CNT = N;
+
+    BlockBuffer()
+    {
+        // Producer starts with block 0, the rest are free
+        for (uint8_t i = 1; i < N; i++)
+        {
+            free_.push(i);
+        }
+        write_idx_ = 0;
+        blocks_[0].reset();
+    }
+
+    // Producer side. Block currently being filled, NULL while a full block is held back (Backpressure).
+    Block* write_block()
+    {
+        return pending_ ? NULL : &blocks_[write_idx_];
+    }
+
+    // Producer side. Hand the current write block to the consumer and switch to the next one.
+    // Returns the index of the published block, -1 if nothing was published (dropped or held back).
+    int publish()
+    {
+        uint8_t next;
+        if (free_.pop(&next) != 0)
+        {
+            // Consumer is behind, no free block to switch to
+            if constexpr (P == OverflowPolicy::DropNewest)
+            {
+                counters_.add_overruns(1);
+                blocks_[write_idx_].reset();
+                return -1;
+            }
+            if constexpr (P == OverflowPolicy::Backpressure)
+            {
+                counters_.add_stall();
+                pending_ = true;
+                return -1;
+            }
+            if constexpr (P == OverflowPolicy::OverwriteOldest)
+            {
+                if (ready_.pop(&next) != 0)
+                {
+                    // Consumer holds every other block, nothing to reclaim
+                    counters_.add_overruns(1);
+                    blocks_[write_idx_].reset();
+                    return -1;
+                }
+                counters_.add_overruns(1);
+            }
+        }
+
+        const int idx = write_idx_;
+        ready_.push((uint8_t)idx); // cannot fail, ready_ holds every index at most once
+        counters_.update_level(ready_.size());
+        write_idx_ = next;
+        pending_ = false;
+        blocks_[next].reset();
+        return idx;
+    }
+
+    // Consumer side. Oldest published block, NULL if none is ready.
+    Block* acquire()
+    {
+        uint8_t idx;
+        if (ready_.pop(&idx) != 0)
+        {
+            counters_.add_underrun();
+            return NULL;
+        }
+        return &blocks_[idx];
+    }
+
+    // Consumer side. Give a block obtained from acquire() back to the producer.
+    void release(Block* block)
+    {
+        free_.push((uint8_t)(block - blocks_));
+    }
+
+    // Number of published blocks waiting for the consumer
+    size_t ready_count() const { return ready_.size(); }
+
+    // Loss accounting in blocks, readable from any context
+    BufferStats stats() const { return counters_.snapshot(); }
+    void reset_stats() { counters_.reset(); }
+
+private:
+    // Smallest power of two that can hold every block index
+    static constexpr size_t queue_cap(size_t n, size_t cap = 1)
+    {
+        return cap >= n ? cap : queue_cap(n, cap * 2);
+    }
+
+    // ready_ needs CAS pops when the producer may reclaim from it
+    static constexpr OverflowPolicy READY_POLICY =
+        P == OverflowPolicy::OverwriteOldest ? OverflowPolicy::OverwriteOldest : OverflowPolicy::DropNewest;
+
+    Block blocks_[N];
+    int write_idx_; // producer owned
+    bool pending_ = false; // producer owned, full block held back under Backpressure
+    RingBuffer<uint8_t, queue_cap(N), READY_POLICY> ready_; // producer -> consumer
+    RingBuffer<uint8_t, queue_cap(N)> free_; // consumer -> producer
+    BufferCounters counters_;
+};
@@ -0,0 +1,82 @@
+/*
+Overflow policies and loss accounting shared by RingBuffer and BlockBuffer.
+
+What happens when the producer (ISR) finds the buffer full:
+- DropNewest: the new data is discarded and counted as an overrun.
+- OverwriteOldest: the oldest unread data is evicted to make room and counted as an overrun.
+  The consumer claims data with a CAS on tail so it can detect that its copy was overwritten.
+- Backpressure: the write is refused without losing anything. The producer keeps its data, is told to
+  back off (nothing ever blocks) and the refusal is counted as a stall.
+
+Every counter has exactly one writer (overruns/stalls/high_water: producer, underruns: consumer), so they
+are updated with plain relaxed load/store pairs instead of read-modify-write atomics. Any context can read
+them through stats(). reset() from a third context may lose an increment that races with it.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+enum class OverflowPolicy : uint8_t
+{
+    DropNewest,
+    OverwriteOldest,
+    Backpressure,
+};
+
+// Snapshot of a buffer's loss counters
+struct BufferStats
+{
+    uint32_t overruns; // items (or blocks) lost because the buffer was full
+    uint32_t underruns; // consumer reads that found less data than requested
+    uint32_t stalls; // producer writes refused under Backpressure
+    uint32_t high_water; // highest fill level seen by the producer
+};
+
+class BufferCounters
+{
+public:
+    void add_overruns(uint32_t n) { add(overruns_, n); }
+    void add_underrun() { add(underruns_, 1); }
+    void add_stall() { add(stalls_, 1); }
+
+    // Producer side. Track the highest fill level.
+    void update_level(uint32_t level)
+    {
+        if (level > high_water_.load(std::memory_order_relaxed))
+        {
+            high_water_.store(level, std::memory_order_relaxed);
+        }
+    }
+
+    BufferStats snapshot() const
+    {
+        BufferStats s;
+        s.overruns = overruns_.load(std::memory_order_relaxed);
+        s.underruns = underruns_.load(std::memory_order_relaxed);
+        s.stalls = stalls_.load(std::memory_order_relaxed);
+        s.high_water = high_water_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset()
+    {
+        overruns_.store(0, std::memory_order_relaxed);
+        underruns_.store(0, std::memory_order_relaxed);
+        stalls_.store(0, std::memory_order_relaxed);
+        high_water_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // Single writer per counter, no need for an atomic read-modify-write
+    static void add(std::atomic<uint32_t>& counter, uint32_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> overruns_{0};
+    std::atomic<uint32_t> underruns_{0};
+    std::atomic<uint32_t> stalls_{0};
+    std::atomic<uint32_t> high_water_{0};
+};
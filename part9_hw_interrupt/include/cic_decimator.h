@@ -0,0 +1,113 @@
+/*
+Integer cascaded integrator-comb (CIC) decimator for oversample-and-decimate acquisition.
+
+The source runs at ratio x the output rate. Each input goes through `order` integrators at the input
+rate; every ratio-th input the result goes through `order` combs (differentiators) and is emitted.
+Order 1 is a plain boxcar average of ratio samples, higher orders trade a wider main lobe for much
+better alias rejection (sinc^order response, nulls at multiples of the output rate).
+
+All arithmetic is unsigned 32-bit and wraps. That is fine for a CIC: as long as the true output fits in
+the register (INPUT_BITS + order * log2(ratio) <= 32), the wrap-arounds in the integrators cancel in the
+combs. check() enforces that bound.
+
+The DC gain is ratio^order, which is a power of two since ratio is. The output keeps extra_bits() of it
+as fraction bits (half a bit per doubling of the ratio, the resolution oversampling actually buys for
+white noise, at most MAX_EXTRA_BITS), so outputs are 12 + extra_bits() bit values and still fit a sample_t.
+ratio 1 passes samples through unchanged.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "sample_block.h"
+
+class CicDecimator
+{
+public:
+    static const uint8_t MAX_ORDER = 4;
+    static const uint8_t INPUT_BITS = 12; // ESP32 ADC resolution
+    static const uint8_t MAX_EXTRA_BITS = 4; // keeps outputs within 16 bits
+
+    // Returns 0 if ratio is a power of two and the register growth fits 32 bits, -1 otherwise
+    static int check(uint16_t ratio, uint8_t order)
+    {
+        if (ratio == 0 || (ratio & (ratio - 1)) != 0 || order == 0 || order > MAX_ORDER)
+        {
+            return -1;
+        }
+        return INPUT_BITS + order * log2(ratio) <= 32 ? 0 : -1;
+    }
+
+    // Set ratio/order (must pass check()) and clear the filter state
+    void configure(uint16_t ratio, uint8_t order)
+    {
+        const uint8_t log2_ratio = log2(ratio);
+        ratio_ = ratio;
+        order_ = order;
+        extra_bits_ = log2_ratio / 2 < MAX_EXTRA_BITS ? log2_ratio / 2 : MAX_EXTRA_BITS;
+        shift_ = order * log2_ratio - extra_bits_;
+        round_ = shift_ > 0 ? 1u << (shift_ - 1) : 0;
+        reset();
+    }
+
+    void reset()
+    {
+        for (uint8_t i = 0; i < MAX_ORDER; i++)
+        {
+            integ_[i] = 0;
+            comb_[i] = 0;
+        }
+        count_ = 0;
+    }
+
+    // Feed one input sample. Returns true and writes *out every ratio-th call.
+    bool push(sample_t in, sample_t* out)
+    {
+        uint32_t x = in;
+        for (uint8_t i = 0; i < order_; i++)
+        {
+            integ_[i] += x;
+            x = integ_[i];
+        }
+
+        if (++count_ < ratio_)
+        {
+            return false;
+        }
+        count_ = 0;
+
+        for (uint8_t i = 0; i < order_; i++)
+        {
+            uint32_t y = x - comb_[i];
+            comb_[i] = x;
+            x = y;
+        }
+        *out = (sample_t)((x + round_) >> shift_);
+        return true;
+    }
+
+    uint16_t ratio() const { return ratio_; }
+    uint8_t order() const { return order_; }
+    uint8_t extra_bits() const { return extra_bits_; }
+
+private:
+    static uint8_t log2(uint16_t ratio)
+    {
+        uint8_t n = 0;
+        while (ratio > 1)
+        {
+            ratio >>= 1;
+            n++;
+        }
+        return n;
+    }
+
+    uint32_t integ_[MAX_ORDER] = {};
+    uint32_t comb_[MAX_ORDER] = {}; // previous comb inputs (delay of one output sample)
+    uint16_t ratio_ = 1;
+    uint16_t count_ = 0;
+    uint32_t round_ = 0;
+    uint8_t order_ = 1;
+    uint8_t shift_ = 0;
+    uint8_t extra_bits_ = 0;
+};
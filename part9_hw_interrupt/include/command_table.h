@@ -0,0 +1,236 @@
+/*
+Table-driven CLI dispatch.
+
+Commands live in one constexpr array of {name, handler, args, help}, sorted by name. The order is checked at
+compile time, so a command added out of place fails the build instead of becoming unreachable, and
+lookup is a binary search: O(log n) string compares whatever the number of commands, and a name only
+matches exactly (no more "avg" matching "avgfoo").
+
+tokenize() splits the command line in place: separators are overwritten with '\0' and argv points into
+the line buffer, so handlers get their arguments without any copy. argv[0] is the command name.
+
+args describes what the arguments may look like, and command_args_match() checks a line against it before
+the handler runs, so every malformed line is refused in one place and handlers only see well-formed
+numbers. Alternatives are separated by '|', the items of one alternative by spaces:
+- <u>: unsigned decimal integer that fits in 32 bits
+- <f>: finite decimal number
+- word or word/word/..: one of these literal words
+An item ending in '?' is optional, one ending in '*' repeats zero or more times. Items match greedily from
+left to right and all arguments must be used. An empty alternative means no arguments.
+*/
+
+#pragma once
+
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef void (*CommandHandler)(uint8_t argc, char** argv);
+
+struct Command
+{
+    const char* name;
+    CommandHandler handler;
+    const char* args; // argument pattern, see above
+    const char* help; // usage, one line
+};
+
+// strcmp() usable in constant expressions
+constexpr int command_name_cmp(const char* a, const char* b)
+{
+    while (*a != '\0' && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+// True if the names are strictly increasing, i.e. sorted and unique
+template <size_t N>
+constexpr bool commands_sorted(const Command (&table)[N])
+{
+    for (size_t i = 1; i < N; i++)
+    {
+        if (command_name_cmp(table[i - 1].name, table[i].name) >= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Binary search for an exact name, NULL if there is no such command
+template <size_t N>
+const Command* find_command(const Command (&table)[N], const char* name)
+{
+    size_t lo = 0;
+    size_t hi = N;
+    while (lo < hi)
+    {
+        const size_t mid = (lo + hi) / 2;
+        const int cmp = strcmp(name, table[mid].name);
+        if (cmp == 0)
+        {
+            return &table[mid];
+        }
+        if (cmp < 0)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+// Split line on spaces, tabs and line ends, in place. Returns the # of arguments, or -1 if there are
+// more than max_args.
+inline int tokenize(char* line, char** argv, uint8_t max_args)
+{
+    uint8_t argc = 0;
+    char* p = line;
+    while (1)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        {
+            *p++ = '\0';
+        }
+        if (*p == '\0')
+        {
+            return argc;
+        }
+        if (argc == max_args)
+        {
+            return -1;
+        }
+        argv[argc++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+        {
+            p++;
+        }
+    }
+}
+
+// True if s is a whole unsigned decimal number that fits in 32 bits (no sign, no trailing characters)
+inline bool is_uint_arg(const char* s)
+{
+    if (*s < '0' || *s > '9')
+    {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    const unsigned long long value = strtoull(s, &end, 10);
+    return *end == '\0' && errno != ERANGE && value <= UINT32_MAX;
+}
+
+// True if s is a whole finite number
+inline bool is_float_arg(const char* s)
+{
+    char* end;
+    const float value = strtof(s, &end);
+    return end != s && *end == '\0' && isfinite(value);
+}
+
+// True if arg matches the pattern item of len characters at item (suffix already stripped)
+inline bool arg_matches_item(const char* item, size_t len, const char* arg)
+{
+    if (len == 3 && strncmp(item, "<u>", 3) == 0)
+    {
+        return is_uint_arg(arg);
+    }
+    if (len == 3 && strncmp(item, "<f>", 3) == 0)
+    {
+        return is_float_arg(arg);
+    }
+
+    // Literal words separated by '/'
+    const size_t arg_len = strlen(arg);
+    const char* end = item + len;
+    while (1)
+    {
+        const char* slash = (const char*)memchr(item, '/', end - item);
+        const char* word_end = slash != NULL ? slash : end;
+        if ((size_t)(word_end - item) == arg_len && strncmp(item, arg, arg_len) == 0)
+        {
+            return true;
+        }
+        if (slash == NULL)
+        {
+            return false;
+        }
+        item = slash + 1;
+    }
+}
+
+// True if argv[1..argc-1] match the one alternative of len characters at alt
+inline bool args_match_alternative(const char* alt, size_t len, uint8_t argc, char** argv)
+{
+    uint8_t i = 1;
+    const char* p = alt;
+    const char* end = alt + len;
+    while (1)
+    {
+        while (p < end && *p == ' ')
+        {
+            p++;
+        }
+        if (p == end)
+        {
+            return i == argc;
+        }
+        const char* item_end = p;
+        while (item_end < end && *item_end != ' ')
+        {
+            item_end++;
+        }
+
+        size_t item_len = item_end - p;
+        const char suffix = p[item_len - 1];
+        if (suffix == '?' || suffix == '*')
+        {
+            item_len--;
+        }
+        if (suffix == '*')
+        {
+            while (i < argc && arg_matches_item(p, item_len, argv[i]))
+            {
+                i++;
+            }
+        }
+        else if (i < argc && arg_matches_item(p, item_len, argv[i]))
+        {
+            i++;
+        }
+        else if (suffix != '?')
+        {
+            return false;
+        }
+        p = item_end;
+    }
+}
+
+// True if the arguments of a tokenized line (argv[0] is the command) match any alternative of pattern
+inline bool command_args_match(const char* pattern, uint8_t argc, char** argv)
+{
+    while (1)
+    {
+        const char* bar = strchr(pattern, '|');
+        const size_t len = bar != NULL ? (size_t)(bar - pattern) : strlen(pattern);
+        if (args_match_alternative(pattern, len, argc, argv))
+        {
+            return true;
+        }
+        if (bar == NULL)
+        {
+            return false;
+        }
+        pattern = bar + 1;
+    }
+}
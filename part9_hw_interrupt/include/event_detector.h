@@ -0,0 +1,100 @@
+/*
+Threshold and edge event detector, evaluated on every raw frame as it is acquired.
+
+Each channel can have a rule with two parts, either of which may be off:
+- Levels with hysteresis: a Rising event when the sample reaches high, a Falling event when it drops back
+  to low or below (low < high). Between the two the state holds, so noise around one threshold cannot
+  make the detector chatter.
+- A rate-of-change limit: a Slope event when two consecutive samples differ by more than max_step ADC
+  counts. The limit is per frame, so it scales with the sample rate.
+
+Rules apply to the raw samples (before decimation and filtering), so thresholds are in ADC counts and an
+event fires on the sample that crosses, not at the end of a window. Each event is pushed into a small
+SPSC ring with the frame's hardware timestamp and the cycle counter at detection, and the handler is woken
+straight away through its Notifier (a direct-to-task notification on the target). The handler drains the ring per wake-up; if it
+falls behind, newer events are dropped and counted.
+
+What the handler sees is the time from the sample to its wake-up, not just from check() to the wake-up:
+the source may hold a frame a while before check() runs. The timer source calls it from the sampling
+ISR, so the two are close. The I2S source only sees samples once a whole DMA buffer is complete (256
+samples, 12.8 ms at 20 kHz), so on that path an event is always that much late and sub-millisecond
+sample-to-handler latency cannot be met.
+
+check() runs in the acquisition path, from ISR or task context. Rules are set from any task and picked up
+at the next frame, which restarts the channel's state without firing: the first sample at or above high
+sets High, anything below it sets Low, so a start inside the band still fires on the first rise.
+*/
+
+#pragma once
+
+#include <atomic>
+#include "notifier.h"
+#include "ring_buffer.h"
+#include "sample_block.h"
+
+enum class EventKind : uint8_t
+{
+    Rising,
+    Falling,
+    Slope,
+};
+
+struct DetectorEvent
+{
+    uint64_t timestamp_us; // hardware timestamp of the frame that fired
+    uint32_t ccount; // CPU cycle counter when the detector fired, see cycle_count()
+    sample_t value;
+    uint8_t channel;
+    EventKind kind;
+};
+
+class EventDetector
+{
+public:
+    static const size_t EVENT_QUEUE_LEN = 16; // power of two
+
+    struct Rule
+    {
+        sample_t high; // 0 = no level detection
+        sample_t low;
+        uint16_t max_step; // 0 = no slope detection
+    };
+
+    // Woken (bit 0) on events. Must be set before the source starts.
+    void begin(Notifier* handler) { handler_ = handler; }
+
+    // Any task. Levels need low < high (or high = 0 to disable them). Returns 0 on success, -1 otherwise.
+    int set_rule(uint8_t channel, const Rule& rule);
+    Rule rule(uint8_t channel) const;
+
+    // Producer side, one raw frame at a time
+    void check(const sample_t* frame, uint8_t channels, uint64_t timestamp_us);
+
+    // Handler side. Returns 0 and fills event if one is queued, -1 otherwise.
+    int pop(DetectorEvent* event) { return events_.pop(event); }
+
+    // Events lost because the handler fell behind
+    uint32_t dropped() const { return events_.stats().overruns; }
+
+private:
+    enum class Level : uint8_t
+    {
+        Unknown, // right after a (re)start, set from the next sample without firing
+        Low,
+        High,
+    };
+
+    void fire(uint8_t channel, EventKind kind, sample_t value, uint64_t timestamp_us);
+
+    Notifier* handler_ = NULL;
+    std::atomic<uint32_t> levels_[SAMPLE_MAX_CHANNELS] = {}; // high | low << 16 as requested
+    std::atomic<uint16_t> max_step_[SAMPLE_MAX_CHANNELS] = {};
+    RingBuffer<DetectorEvent, EVENT_QUEUE_LEN> events_;
+
+    // Producer owned
+    uint8_t channels_ = 0;
+    bool primed_ = false; // prev_ holds the previous frame
+    uint32_t applied_levels_[SAMPLE_MAX_CHANNELS] = {};
+    Level level_[SAMPLE_MAX_CHANNELS] = {};
+    sample_t prev_[SAMPLE_MAX_CHANNELS] = {};
+};
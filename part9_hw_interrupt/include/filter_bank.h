@@ -0,0 +1,105 @@
+/*
+Filter stage between the block handoff and the statistics: an optional FIR followed by an optional
+cascade of biquads, run per channel over every block and written back into the block in place
+(rounded and clamped to the sample range), so everything downstream sees filtered samples.
+
+A design that blocks DC (high-pass, band-pass, or anything with a DC gain below 1/2) outputs a signal
+centred on 0, which the unsigned samples cannot hold: clamping would keep only the positive half-cycles.
+Its output gets a mid-scale offset of 2^11 ADC counts (2^(11 + frac_bits) in sample units), recorded in
+block.offset, so swings of up to +-2048 counts survive whole. The statistics, quantiles and aggregates
+subtract it again and report signed values.
+
+Two backends run the same filters on float copies of one channel at a time:
+- EspDsp: Espressif's esp-dsp kernels (dsps_fir_f32, dsps_biquad_f32), hand-optimized for the ESP32.
+  Only built when <esp_dsp.h> is available (it ships with arduino-esp32).
+- Portable: plain C++ with the inner FIR loop over contiguous arrays so compilers can vectorize it.
+Both keep the filter state in the same format (FIR: the last taps-1 inputs, oldest first; biquad: the two
+direct form II delay elements), so the backend can be switched between blocks without a glitch.
+
+Biquads follow the esp-dsp convention: {b0, b1, b2, a1, a2} with a0 = 1, y = b0 x + b1 x1 + b2 x2 -
+a1 y1 - a2 y2.
+
+Coefficients can be changed from any task: set_fir()/set_biquads() stage a new config, and the
+consumer applies it (and clears the filter state) at its next process(). A second change is refused
+until the first one has been picked up. With no filter configured process() returns right away and
+no floating point is used.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include "sample_block.h"
+
+class FilterBank
+{
+public:
+    static const uint8_t FIR_MAX_TAPS = 64;
+    static const uint8_t BIQUAD_MAX_STAGES = 4;
+    static const uint8_t BIQUAD_COEFS = 5; // b0 b1 b2 a1 a2
+
+    enum class Backend : uint8_t
+    {
+        Portable,
+        EspDsp,
+    };
+
+    FilterBank();
+
+    // True if the esp-dsp kernels were built in
+    static bool has_esp_dsp();
+
+    // Kernels, in place on len samples of one channel. fir_rev holds the taps in reverse order (h[taps-1]
+    // first), history the previous taps-1 inputs, oldest first, and is updated. w holds the biquad state.
+    static void fir(Backend backend, const float* fir_rev, uint8_t taps, float* history, float* x, uint16_t len);
+    static void biquad(Backend backend, const float* coefs, float* w, float* x, uint16_t len);
+
+    // Any task. taps 0 (or stages 0) removes that filter. Returns 0 on success, -1 if the count is out
+    // of range or the previous change has not been applied yet.
+    int set_fir(const float* taps, uint8_t count);
+    int set_biquads(const float* coefs, uint8_t stages);
+    int clear(); // both at once
+
+    // Any task. Backend used by process(), EspDsp is refused when it was not built in.
+    int set_backend(Backend backend);
+    Backend backend() const { return backend_.load(std::memory_order_relaxed); }
+
+    // Requested config as last staged, for printing. taps/coefs in normal order.
+    uint8_t fir_taps() const { return staged_.fir_taps; }
+    float fir_tap(uint8_t i) const { return staged_.fir_rev[staged_.fir_taps - 1 - i]; }
+    uint8_t biquad_stages() const { return staged_.stages; }
+    const float* biquad_coefs(uint8_t stage) const { return staged_.biquad[stage]; }
+
+    // True if the staged design blocks DC, so its output is offset by MID_SCALE
+    bool offsets_output() const { return dc_gain(staged_) < 0.5f; }
+
+    // Consumer side. Filter every channel of block in place.
+    void process(SampleBlock& block);
+
+    static const uint16_t MID_SCALE = 1 << 11; // ADC counts added to the output of a DC-blocking design
+
+private:
+    struct Config
+    {
+        float fir_rev[FIR_MAX_TAPS];
+        uint8_t fir_taps;
+        float biquad[BIQUAD_MAX_STAGES][BIQUAD_COEFS];
+        uint8_t stages;
+    };
+
+    static float dc_gain(const Config& config);
+    void reset_state();
+
+    Config staged_; // written by the setters while staged_ready_ is false
+    std::atomic<bool> staged_ready_{false};
+    std::atomic<Backend> backend_;
+
+    // Consumer owned
+    Config active_;
+    bool active_offset_ = false; // active_ blocks DC, see MID_SCALE
+    uint8_t channels_ = 0;
+    uint8_t frac_bits_ = 0;
+    float fir_history_[SAMPLE_MAX_CHANNELS][FIR_MAX_TAPS - 1];
+    float biquad_w_[SAMPLE_MAX_CHANNELS][BIQUAD_MAX_STAGES][2];
+    float work_[SAMPLE_BLOCK_MAX];
+};
@@ -0,0 +1,65 @@
+/*
+Unsigned fixed-point helpers for the averaging path.
+
+A mean is computed as round(sum / n) in Q(32-F).F without a division: 1/n is turned once into a 32-bit
+multiplier and a shift (Reciprocal), after which every mean is one 32x32->64 multiply, an add for the
+rounding and a shift. Only integer instructions are used, so the path is safe in an ISR and a task
+using it never touches the FPU (no lazy FPU context save on the ESP32).
+
+For n in [2^k, 2^(k+1)) the multiplier is round(2^(32+k) / n), which always fits 32 bits. Its error of at
+most 1/2 is scaled by sum / 2^(32+k), so for sums of 16-bit samples (sum < 2^16 * n) the result is off
+by less than 2^-16 before the final rounding, i.e. within 1 LSB of the exact Q16.16 mean.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t uq16_16_t; // unsigned Q16.16
+
+// x / n ~= (x * mul) >> shift
+struct Reciprocal
+{
+    uint32_t mul;
+    uint8_t shift;
+};
+
+// n must be at least 1. Costs one 64-bit division, so compute it once per n, not once per mean.
+inline Reciprocal reciprocal(uint32_t n)
+{
+    uint8_t k = 31 - __builtin_clz(n);
+    Reciprocal r;
+    if ((n & (n - 1)) == 0)
+    {
+        // Power of two, 2^(32+k) / n would need 33 bits
+        r.mul = 1u << 31;
+        r.shift = 31 + k;
+        return r;
+    }
+    r.shift = 32 + k;
+    r.mul = (uint32_t)(((1ull << r.shift) + n / 2) / n);
+    return r;
+}
+
+// round(sum / (n * 2^in_frac)) in Q(32-F).F, with r = reciprocal(n). in_frac is the number of fraction
+// bits the samples already carry (decimation). The result must fit 32 bits: mean < 2^(32-F).
+template <uint8_t F>
+inline uint32_t fixed_mean(uint32_t sum, Reciprocal r, uint8_t in_frac)
+{
+    static_assert(F <= 16, "fixed_mean() rounds with at least 16 spare bits");
+    const uint8_t shift = r.shift + in_frac - F;
+    return (uint32_t)(((uint64_t)sum * r.mul + (1ull << (shift - 1))) >> shift);
+}
+
+// Split a Q16.16 value into integer part and decimals (rounded, decimals < 10^digits) for printing
+inline void q16_16_parts(uq16_16_t q, uint8_t digits, uint32_t* int_part, uint32_t* decimals)
+{
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < digits; i++)
+    {
+        scale *= 10;
+    }
+    uint64_t frac = ((uint64_t)(q & 0xFFFF) * scale + 0x8000) >> 16;
+    *int_part = (q >> 16) + (frac == scale); // rounding carried into the integer part
+    *decimals = frac == scale ? 0 : (uint32_t)frac;
+}
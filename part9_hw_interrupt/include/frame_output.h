@@ -0,0 +1,23 @@
+/*
+Byte sink for FrameStream.
+
+The stream must never stall the consumer task on a slow link, so before a frame goes out it asks how many
+bytes the sink takes without blocking and drops the frame if it does not fit. SerialFrameOutput
+(serial_frame_output.h) implements this on the UART; host tests write into a pseudo-terminal or a buffer.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class FrameOutput
+{
+public:
+    virtual ~FrameOutput() {}
+
+    // # of bytes write() accepts right now without blocking
+    virtual size_t available_for_write() = 0;
+
+    virtual void write(const uint8_t* data, size_t len) = 0;
+};
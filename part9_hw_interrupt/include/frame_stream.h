@@ -0,0 +1,87 @@
+/*
+Binary streaming of sample blocks over the serial port, for bulk export to a host.
+
+Each block becomes one frame: a fixed header, the samples exactly as they sit in the block, and a CRC-32,
+COBS-encoded so the frame contains no 0x00 and a single 0x00 byte ends it. A reader that starts mid-stream
+or loses bytes resynchronizes at the next 0x00, and the CRC rejects any frame that was damaged or had text
+mixed into it. COBS adds at most 1 byte per 254, so the stream runs close to the line rate.
+
+Frame before encoding, all fields little endian (the ESP32's own byte order, so nothing is converted):
+    offset  size
+    0       1     version (FRAME_VERSION)
+    1       1     channels
+    2       1     frac_bits
+    3       1     reserved, 0
+    4       4     sequence number, +1 per frame sent, a gap means frames were lost on the way
+    8       2     frames in this block
+    10      2     reserved, 0
+    12      8     t0_us, timestamp of the first frame
+    20      4     period_ns, nominal frame period
+    24      2*n   samples, n = frames * channels, interleaved by channel
+    24+2n   4     CRC-32 (zlib/IEEE) of everything before it
+Per-frame jitter is not sent; the host places frame i at t0_us + i * period_ns.
+
+The encoder works in COBS groups of at most 254 bytes, so the only staging is one group buffer; header,
+samples and CRC are read straight from their memory and never formatted. tools/frame_decoder.h is the
+matching host decoder, tools/stream_decoder.cpp the command line tool around it.
+
+write_block() never waits for the link. A frame is only sent if the output takes its worst-case encoded
+length without blocking; otherwise it is dropped and counted, and its sequence number is used up anyway,
+so the host sees the gap. At 115200 baud a 20 kHz I2S source produces far more than the line carries, and
+dropping frames keeps the consumer task on time instead of letting the block queue overflow.
+
+Owned by the consumer task. set_enabled() may be called from any task.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "frame_output.h"
+#include "sample_block.h"
+
+class FrameStream
+{
+public:
+    static const uint8_t FRAME_VERSION = 1;
+    static const size_t HEADER_LEN = 24;
+    static const size_t CRC_LEN = 4;
+
+    explicit FrameStream(FrameOutput& out) : out_(out) {}
+
+    // Any task
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Consumer side. Send block as one frame if streaming is enabled and the output has room for it, never
+    // blocks. Returns 0 if a frame was sent, -1 if streaming is off or the frame was dropped.
+    int write_block(const SampleBlock& block);
+
+    // Encoded length of a frame of samples_len sample bytes in the worst case (no zero byte to spare a
+    // COBS group), delimiter included
+    static size_t max_encoded_len(size_t samples_len);
+
+    uint32_t frames_sent() const { return frames_.load(std::memory_order_relaxed); }
+    uint32_t frames_dropped() const { return dropped_.load(std::memory_order_relaxed); } // output was full
+    uint32_t bytes_sent() const { return bytes_.load(std::memory_order_relaxed); } // encoded, delimiters included
+
+    // CRC-32 as computed by zlib's crc32(), crc = 0 to start
+    static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t len);
+
+private:
+    // COBS encoder, one group at a time
+    void put(const uint8_t* data, size_t len);
+    void flush_group();
+    void end_frame();
+
+    FrameOutput& out_;
+    std::atomic<bool> enabled_{false};
+    std::atomic<uint32_t> frames_{0};
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<uint32_t> bytes_{0};
+    uint32_t seq_ = 0;
+    uint32_t frame_bytes_ = 0; // encoded bytes of the frame being sent
+    uint8_t group_[255]; // code byte + up to 254 data bytes
+    uint8_t group_len_ = 1;
+};
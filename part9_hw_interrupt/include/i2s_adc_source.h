@@ -0,0 +1,50 @@
+/*
+Continuous ADC sample source using the ESP32 I2S peripheral in built-in ADC mode.
+
+The I2S peripheral clocks ADC1 on its own and DMAs the conversions into a ring of DMA buffers, so there
+is no per-sample interrupt and rates of tens of kHz are possible. A reader task blocks in i2s_read(),
+strips the channel bits from each 16-bit DMA word and hands the whole block to the sink. Samples reach
+the sink, the event detector included, only once their DMA buffer is full: DMA_BUF_LEN samples late for
+the first one, 12.8 ms at 20 kHz.
+
+end() does not delete the reader, which could be inside i2s_read() holding the driver's lock. It raises
+a stop flag and waits for the reader to leave its loop: reads time out after READ_TIMEOUT_MS, so the
+flag is seen within that plus one block, and the reader then deletes itself. Only after that is the
+driver uninstalled.
+
+Only ADC1 pins can be used (ADC2 is not routed to I2S), only one pin can be scanned (the legacy driver
+has no multi-channel pattern support) and only one instance can be active since the built-in ADC is
+tied to I2S0.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "sample_source.h"
+
+class I2sAdcSource : public SampleSource
+{
+public:
+    explicit I2sAdcSource(BaseType_t core);
+
+    bool begin(SampleSink* sink, uint32_t rate_hz) override;
+    void end() override;
+    bool set_rate(uint32_t rate_hz) override;
+    const char* name() const override { return "i2s"; }
+    uint8_t max_channels() const override { return 1; }
+
+    static const size_t DMA_BUF_LEN = 256; // samples per DMA buffer, also the block size handed to the sink
+    static const size_t DMA_BUF_CNT = 4;
+    static const uint32_t READ_TIMEOUT_MS = 20; // how long the reader blocks before checking the stop flag
+
+private:
+    static void taskRead(void* parameters);
+
+    const BaseType_t core_;
+    SampleSink* sink_ = NULL;
+    TaskHandle_t task_ = NULL;
+    std::atomic<bool> stop_{false}; // set by end(), the reader leaves its loop
+    std::atomic<bool> reading_{false}; // reader still in its loop and may be inside the driver
+    sample_t dma_buf_[DMA_BUF_LEN];
+};
@@ -0,0 +1,89 @@
+/*
+Fixed-bucket histogram of CPU cycle counts (or any other unsigned measure, such as microseconds), cheap
+enough to update from an ISR.
+
+Buckets are linear, 2^SHIFT cycles wide, so recording a value is a shift, a compare, an increment and the
+min/max checks - no division, no loops, no locks. The last bucket collects everything above the range.
+
+The ISR is the only writer. A reader in another task may see a snapshot that is a few updates stale, but
+never a torn counter. reset() only raises a flag; the writer clears the counters itself on its next
+record(), so a reset can never race with an increment. Until then the readers report an empty histogram,
+so a reset shows at once even when nothing is being recorded.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <uint8_t SHIFT, size_t N>
+class IsrHistogram
+{
+    static_assert(N >= 2, "IsrHistogram needs at least one bucket plus the overflow bucket");
+
+public:
+    static constexpr size_t BUCKET_CNT = N;
+    static constexpr uint32_t BUCKET_WIDTH = 1u << SHIFT;
+
+    // Writer side (ISR)
+    void record(uint32_t cycles)
+    {
+        if (reset_pending_.load(std::memory_order_relaxed))
+        {
+            clear();
+        }
+
+        size_t idx = cycles >> SHIFT;
+        if (idx >= N)
+        {
+            idx = N - 1;
+        }
+        bump(counts_[idx]);
+        bump(count_);
+        if (cycles < min_.load(std::memory_order_relaxed))
+        {
+            min_.store(cycles, std::memory_order_relaxed);
+        }
+        if (cycles > max_.load(std::memory_order_relaxed))
+        {
+            max_.store(cycles, std::memory_order_relaxed);
+        }
+    }
+
+    // Reader side, any context. Empty while a reset is pending.
+    uint32_t bucket(size_t idx) const { return pending() ? 0 : counts_[idx].load(std::memory_order_relaxed); }
+    uint32_t count() const { return pending() ? 0 : count_.load(std::memory_order_relaxed); }
+    uint32_t min() const { return pending() ? UINT32_MAX : min_.load(std::memory_order_relaxed); }
+    uint32_t max() const { return pending() ? 0 : max_.load(std::memory_order_relaxed); }
+
+    // Ask the writer to start over, takes effect on the next record()
+    void reset() { reset_pending_.store(true, std::memory_order_relaxed); }
+
+private:
+    // Acquire pairs with the release in clear(): once the flag reads false, so do the cleared counters
+    bool pending() const { return reset_pending_.load(std::memory_order_acquire); }
+
+    static void bump(std::atomic<uint32_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            counts_[i].store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        min_.store(UINT32_MAX, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+        reset_pending_.store(false, std::memory_order_release);
+    }
+
+    std::atomic<uint32_t> counts_[N] = {};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint32_t> min_{UINT32_MAX};
+    std::atomic<uint32_t> max_{0};
+    std::atomic<bool> reset_pending_{false};
+};
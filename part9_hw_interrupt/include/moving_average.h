@@ -0,0 +1,155 @@
+/*
+Sliding-window moving average over the last len() frames, per channel, in O(1) per sample.
+
+Each channel keeps an integer running sum: a new sample is added and the one falling out of the window
+(read back from a history ring) is subtracted. Integer arithmetic is exact, so the sum never drifts no
+matter how long it runs, and a 10000-frame window costs the same per sample as a 10-frame one. Only the
+final mean() is converted to float; mean_fixed() stays in integers (see fixed_point.h).
+
+The history is a fixed array of CAPACITY samples shared by all channels (no heap), so the longest window
+is CAPACITY / channels frames. With 16-bit samples and a 32-bit sum, windows up to 65537 frames cannot
+overflow.
+
+Owned by the consumer task. set_len() may be called from any task; the new length is picked up by the
+next push_block(), which also restarts the window when the block layout (channel count or decimation
+fraction bits) or the filter's mid-scale offset changes, so a window never mixes layouts. Until the
+window has filled, mean() averages the frames seen so far.
+
+The sums are over the raw samples. mean() subtracts the block's offset (see filter_bank.h) and can go
+negative; mean_fixed() is unsigned and does not, offset_fixed() gives the value to subtract.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "fixed_point.h"
+#include "sample_block.h"
+
+template <size_t CAPACITY>
+class MovingAverage
+{
+    static_assert(CAPACITY >= SAMPLE_MAX_CHANNELS, "MovingAverage needs room for one frame");
+    static_assert(CAPACITY <= 65537, "MovingAverage sums could overflow 32 bits");
+
+public:
+    explicit MovingAverage(uint32_t len) : requested_len_(len) {}
+
+    // Any task. Frames per window, 1..CAPACITY (clamped to CAPACITY / channels when applied).
+    // Returns 0 on success, -1 if out of range.
+    int set_len(uint32_t len)
+    {
+        if (len == 0 || len > CAPACITY)
+        {
+            return -1;
+        }
+        requested_len_.store(len, std::memory_order_relaxed);
+        return 0;
+    }
+
+    // Requested window, the one in use may be shorter with several channels
+    uint32_t requested_len() const { return requested_len_.load(std::memory_order_relaxed); }
+
+    // Consumer side. Slide the window over every frame of block.
+    void push_block(const SampleBlock& block)
+    {
+        const uint32_t req = requested_len_.load(std::memory_order_relaxed);
+        if (block.channels != channels_ || block.frac_bits != frac_bits_ || block.offset != offset_ ||
+            req != applied_len_)
+        {
+            restart(block.channels, block.frac_bits, req);
+            offset_ = block.offset;
+        }
+
+        const uint8_t channels = channels_;
+        const uint32_t span = len_ * channels;
+        for (uint16_t i = 0; i < block.len; i += channels)
+        {
+            const sample_t* frame = &block.samples[i];
+            sample_t* old = &history_[pos_];
+            for (uint8_t c = 0; c < channels; c++)
+            {
+                sum_[c] += frame[c];
+                sum_[c] -= old[c]; // 0 until the window has filled
+                old[c] = frame[c];
+            }
+            pos_ += channels;
+            if (pos_ == span)
+            {
+                pos_ = 0;
+            }
+            if (count_ < len_)
+            {
+                count_++;
+            }
+        }
+
+        // Only changes while the window fills, so the division is rare
+        if (count_ != recip_count_)
+        {
+            recip_ = reciprocal(count_);
+            recip_count_ = count_;
+        }
+    }
+
+    // Consumer side
+    uint8_t channels() const { return channels_; }
+    uint32_t len() const { return len_; } // window in use, frames
+    uint32_t count() const { return count_; } // frames currently in the window
+    uint32_t sum(uint8_t channel) const { return sum_[channel]; } // in units of 2^-frac_bits ADC counts
+
+    // Mean of channel in ADC counts, 0 before the first frame
+    float mean(uint8_t channel) const
+    {
+        return count_ == 0 ? 0.f : (sum_[channel] / (float)count_ - offset_) / (1u << frac_bits_);
+    }
+
+    // Mean of channel in ADC counts as unsigned Q(32-F).F, rounded, 0 before the first frame. Still
+    // includes the offset.
+    template <uint8_t F>
+    uint32_t mean_fixed(uint8_t channel) const
+    {
+        return count_ == 0 ? 0 : fixed_mean<F>(sum_[channel], recip_, frac_bits_);
+    }
+
+    // Offset included in mean_fixed(), same format, 0 without a DC-blocking filter
+    template <uint8_t F>
+    uint32_t offset_fixed() const
+    {
+        return ((uint32_t)offset_ << F) >> frac_bits_;
+    }
+
+private:
+    void restart(uint8_t channels, uint8_t frac_bits, uint32_t len)
+    {
+        channels_ = channels;
+        frac_bits_ = frac_bits;
+        applied_len_ = len;
+        len_ = len * channels <= CAPACITY ? len : CAPACITY / channels;
+        pos_ = 0;
+        count_ = 0;
+        recip_count_ = 0;
+        for (uint8_t c = 0; c < SAMPLE_MAX_CHANNELS; c++)
+        {
+            sum_[c] = 0;
+        }
+        for (uint32_t i = 0; i < len_ * channels; i++)
+        {
+            history_[i] = 0;
+        }
+    }
+
+    std::atomic<uint32_t> requested_len_;
+    uint32_t applied_len_ = 0; // requested length the window was last built for
+    uint32_t len_ = 0;
+    uint32_t pos_ = 0; // next history slot to overwrite, in samples
+    uint32_t count_ = 0;
+    uint8_t channels_ = 0;
+    uint8_t frac_bits_ = 0;
+    sample_t offset_ = 0; // of the blocks in the window
+    Reciprocal recip_ = {}; // 1 / count_
+    uint32_t recip_count_ = 0;
+    uint32_t sum_[SAMPLE_MAX_CHANNELS] = {};
+    sample_t history_[CAPACITY];
+};
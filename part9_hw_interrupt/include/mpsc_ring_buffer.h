@@ -0,0 +1,152 @@
+/*
+Lock-free multi-producer/single-consumer (MPSC) ring buffer.
+
+Lets several producers (timer ISRs or sampling tasks on core 0 and core 1) feed one aggregation task.
+RingBuffer assumes a single producer, so here each producer reserves a slot with a CAS on the shared
+head counter instead. Every slot carries a sequence number that says whose turn it is:
+- seq == pos: slot is free for the producer that reserves position pos,
+- seq == pos + 1: slot holds the item at position pos and is ready for the consumer,
+- after the consumer reads it, seq = pos + N frees the slot for the next lap.
+Producers publish with a release store of the slot sequence, so the consumer never reads a slot that
+is still being written even though producers may finish out of order. An item only becomes visible once
+every item reserved before it has been written, so the FIFO order is the order of the head reservations.
+
+The CAS on head is an s32c1i on the Xtensa cores and is coherent across both cores, so no spinlock or
+critical section is needed. A producer that is preempted between reserving and publishing only delays
+the consumer; other producers (including ISRs that preempted it) keep making progress.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include "buffer_policy.h"
+
+template <typename T, size_t N>
+class MpscRingBuffer
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscRingBuffer capacity must be a power of two");
+    static_assert(N <= (1ul << 30), "MpscRingBuffer capacity must leave room for the sequence numbers");
+    static_assert(std::is_trivially_copyable<T>::value, "MpscRingBuffer elements are copied with plain stores");
+
+public:
+    static constexpr size_t CAPACITY = N;
+    static constexpr uint32_t MASK = N - 1;
+
+    MpscRingBuffer()
+    {
+        for (uint32_t i = 0; i < N; i++)
+        {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer side, any core/context. Returns 0 on success, -1 if the buffer is full (item dropped).
+    int push(const T& data)
+    {
+        uint32_t pos = head_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (1)
+        {
+            slot = &slots_[pos & MASK];
+            const uint32_t seq = slot->seq.load(std::memory_order_acquire);
+            const int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0)
+            {
+                // Slot is free for this lap, try to reserve it. On failure pos is reloaded.
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // Consumer has not freed this slot from the previous lap yet, queue is full
+                overruns_.fetch_add(1, std::memory_order_relaxed);
+                return -1;
+            }
+            else
+            {
+                // Another producer took this position, catch up
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->data = data;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        update_level(pos + 1 - tail_.load(std::memory_order_relaxed));
+        return 0;
+    }
+
+    // Consumer side. Retrieve value via data. Success if return value is 0.
+    int pop(T* data)
+    {
+        const uint32_t pos = tail_.load(std::memory_order_relaxed);
+        Slot* slot = &slots_[pos & MASK];
+        const uint32_t seq = slot->seq.load(std::memory_order_acquire);
+
+        // Empty, or the producer that reserved this position has not finished writing it
+        if ((int32_t)(seq - (pos + 1)) < 0)
+        {
+            underruns_.store(underruns_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return -1;
+        }
+
+        *data = slot->data;
+        slot->seq.store(pos + N, std::memory_order_release); // free the slot for the next lap
+        tail_.store(pos + 1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    // Number of reserved items, a snapshot when producers are active
+    size_t size() const
+    {
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        return head_.load(std::memory_order_acquire) - tail;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Loss accounting, readable from any context (stalls is always 0, there is no backpressure mode)
+    BufferStats stats() const
+    {
+        BufferStats s;
+        s.overruns = overruns_.load(std::memory_order_relaxed);
+        s.underruns = underruns_.load(std::memory_order_relaxed);
+        s.stalls = 0;
+        s.high_water = high_water_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset_stats()
+    {
+        overruns_.store(0, std::memory_order_relaxed);
+        underruns_.store(0, std::memory_order_relaxed);
+        high_water_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> seq;
+        T data;
+    };
+
+    // Several producers may race here, so the maximum needs a CAS loop
+    void update_level(uint32_t level)
+    {
+        uint32_t seen = high_water_.load(std::memory_order_relaxed);
+        while (level > seen && !high_water_.compare_exchange_weak(seen, level, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    Slot slots_[N];
+    std::atomic<uint32_t> head_{0}; // next position to reserve (shared by producers)
+    std::atomic<uint32_t> tail_{0}; // next position to read (consumer owned)
+    std::atomic<uint32_t> overruns_{0}; // written by every producer
+    std::atomic<uint32_t> underruns_{0}; // consumer owned
+    std::atomic<uint32_t> high_water_{0};
+};
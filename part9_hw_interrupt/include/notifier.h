@@ -0,0 +1,22 @@
+/*
+Wake-up path from the acquisition stages to the task that consumes their output.
+
+Acquisition and EventDetector run in ISR or task context and only ever need to tell one consumer that
+something is ready. They do it through this interface, so they carry no FreeRTOS dependency and the
+pipeline builds on a host: TaskNotifier (task_notifier.h) implements it with direct-to-task notifications
+on the target, host tests and benchmarks plug in their own.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+class Notifier
+{
+public:
+    virtual ~Notifier() {}
+
+    // OR bits into the consumer's notification value and wake it. Called from ISR or task context, must
+    // not block.
+    virtual void notify(uint32_t bits) = 0;
+};
@@ -0,0 +1,32 @@
+/*
+The few target facilities the portable stages (acquisition, event detection) use, with host stand-ins so
+the same sources also build and run on a Linux host.
+
+- IRAM_ATTR keeps ISR-path code in internal RAM on the ESP32 and means nothing on the host.
+- cycle_count() reads the CPU cycle counter (CCOUNT) on the ESP32. The host has no cheap portable
+  equivalent, so there it returns nanoseconds of a monotonic clock, wrapping at 32 bits like CCOUNT.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#if __has_include(<xtensa/core-macros.h>)
+#include <esp_attr.h>
+#include <xtensa/core-macros.h>
+
+static inline uint32_t IRAM_ATTR cycle_count()
+{
+    return xthal_get_ccount();
+}
+#else
+#include <chrono>
+
+#define IRAM_ATTR
+
+static inline uint32_t cycle_count()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+#endif
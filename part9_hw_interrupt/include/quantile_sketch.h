@@ -0,0 +1,140 @@
+/*
+Fixed-memory streaming quantile sketch for 16-bit samples (log-linear histogram, as in HdrHistogram).
+
+Values below 2^SUB_BITS get a bucket each (exact). Above that, every power-of-two range is split into
+2^(SUB_BITS-1) equal buckets, so a bucket is never wider than 2^-(SUB_BITS-1) of the values it holds.
+quantile() returns the middle of the bucket the rank falls in, so the answer is within 2^-SUB_BITS
+(relative) of a sample that really has that rank, whatever the distribution and however long the stream.
+RAM is fixed at compile time: BUCKET_CNT 32-bit counters.
+
+Adding a sample is a count-leading-zeros, a shift and an increment. When the total reaches 2^31 every
+counter is halved, which keeps the counters from overflowing and slowly ages out old samples.
+
+Single writer (the consumer task), as IsrHistogram (isr_histogram.h): the counters are relaxed atomics, so
+readers in other tasks see counters that may be a few samples behind but never torn. reset() may be
+called from any task and only raises a flag; the writer clears the counters itself on its next add().
+Until then readers report an empty sketch, so a reset shows at once even when nothing is being added.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <uint8_t SUB_BITS>
+class QuantileSketch
+{
+    static_assert(SUB_BITS >= 2 && SUB_BITS <= 12, "QuantileSketch supports 2..12 sub-bucket bits");
+
+public:
+    static constexpr uint8_t VALUE_BITS = 16;
+    static constexpr size_t BUCKET_CNT = (1u << SUB_BITS) + (VALUE_BITS - SUB_BITS) * (1u << (SUB_BITS - 1));
+
+    // Writer side
+    void add(uint16_t value)
+    {
+        if (reset_pending_.load(std::memory_order_relaxed))
+        {
+            clear();
+        }
+
+        bump(counts_[index(value)]);
+        if (bump(total_) >= (1u << 31))
+        {
+            halve();
+        }
+    }
+
+    // Any context. Empty while a reset is pending.
+    void reset() { reset_pending_.store(true, std::memory_order_relaxed); }
+    uint32_t total() const { return pending() ? 0 : total_.load(std::memory_order_relaxed); }
+
+    // Value at quantile q (0..1), 0 if the sketch is empty
+    uint16_t quantile(float q) const
+    {
+        const uint32_t total = this->total();
+        if (total == 0)
+        {
+            return 0;
+        }
+        uint32_t rank = (uint32_t)(q * total + 0.5f);
+        rank = rank < 1 ? 1 : (rank > total ? total : rank);
+
+        uint32_t seen = 0;
+        for (size_t i = 0; i < BUCKET_CNT; i++)
+        {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                return midpoint(i);
+            }
+        }
+        return midpoint(BUCKET_CNT - 1); // only reachable while the writer is halving
+    }
+
+private:
+    static constexpr uint32_t SUB_CNT = 1u << SUB_BITS;
+    static constexpr uint32_t HALF_SUB_CNT = SUB_CNT / 2;
+
+    static size_t index(uint16_t value)
+    {
+        if (value < SUB_CNT)
+        {
+            return value;
+        }
+        const uint8_t msb = 31 - __builtin_clz(value); // >= SUB_BITS
+        const uint8_t shift = msb - SUB_BITS + 1;
+        return SUB_CNT + (msb - SUB_BITS) * HALF_SUB_CNT + ((value >> shift) - HALF_SUB_CNT);
+    }
+
+    // Middle of the value range of bucket idx
+    static uint16_t midpoint(size_t idx)
+    {
+        if (idx < SUB_CNT)
+        {
+            return idx;
+        }
+        const uint8_t octave = (idx - SUB_CNT) / HALF_SUB_CNT; // msb - SUB_BITS
+        const uint8_t shift = octave + 1;
+        const uint32_t sub = HALF_SUB_CNT + (idx - SUB_CNT) % HALF_SUB_CNT;
+        return (sub << shift) + ((1u << shift) - 1) / 2;
+    }
+
+    // Acquire pairs with the release in clear(): once the flag reads false, so do the cleared counters
+    bool pending() const { return reset_pending_.load(std::memory_order_acquire); }
+
+    // Only the writer stores, so a load and a store is enough. Returns the new value.
+    static uint32_t bump(std::atomic<uint32_t>& counter)
+    {
+        const uint32_t n = counter.load(std::memory_order_relaxed) + 1;
+        counter.store(n, std::memory_order_relaxed);
+        return n;
+    }
+
+    void halve()
+    {
+        uint32_t total = 0;
+        for (size_t i = 0; i < BUCKET_CNT; i++)
+        {
+            const uint32_t n = counts_[i].load(std::memory_order_relaxed) / 2;
+            counts_[i].store(n, std::memory_order_relaxed);
+            total += n;
+        }
+        total_.store(total, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < BUCKET_CNT; i++)
+        {
+            counts_[i].store(0, std::memory_order_relaxed);
+        }
+        total_.store(0, std::memory_order_relaxed);
+        reset_pending_.store(false, std::memory_order_release);
+    }
+
+    std::atomic<uint32_t> counts_[BUCKET_CNT] = {};
+    std::atomic<uint32_t> total_{0};
+    std::atomic<bool> reset_pending_{false};
+};
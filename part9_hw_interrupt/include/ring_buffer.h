@@ -0,0 +1,238 @@
+/*
+Lock-free single-producer/single-consumer (SPSC) ring buffer.
+
+The producer (the timer ISR) only ever writes head and the consumer (a task) only ever writes tail
+(except under OverwriteOldest, see below), so no critical section is needed. head and tail are free-running counters and the slot is selected by
+masking with (N - 1), which is why the capacity must be a power of two. Because the counters are never
+wrapped back to 0, full (head - tail == N) and empty (head == tail) are different states.
+
+The element type and capacity are template parameters, so CAPACITY and MASK are compile-time constants
+and push()/pop() reduce to a load, a mask, a copy and a store. T can be a raw 16-bit sample, a
+timestamped sample or a multi-channel frame, as long as it is trivially copyable.
+
+Memory ordering:
+- push() writes the slot and then publishes it with a release store of head.
+- pop() reads head with acquire (so the slot contents are visible), reads the slot and then frees it
+  with a release store of tail.
+
+Bulk operations follow the same rules: push_n()/pop_n() copy up to two memcpy runs and publish the
+whole run with a single store. peek_contiguous() hands the consumer up to two regions that point
+straight into the buffer memory; they stay valid until consume() releases them.
+
+The overflow policy (see buffer_policy.h) is a template parameter so the default DropNewest path pays
+nothing for the others. With OverwriteOldest the producer may advance tail too, so pop() claims its item
+with a CAS on tail and retries if the producer evicted it meanwhile. In-place access (peek_contiguous()
+and consume()) cannot be made safe against eviction and is not available with that policy.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "buffer_policy.h"
+
+template <typename T, size_t N, OverflowPolicy P = OverflowPolicy::DropNewest>
+class RingBuffer
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+    static_assert(N <= (1ul << 31), "RingBuffer capacity must fit the 32-bit index counters");
+    static_assert(std::is_trivially_copyable<T>::value, "RingBuffer elements are copied with plain stores");
+
+public:
+    static constexpr size_t CAPACITY = N;
+    static constexpr uint32_t MASK = N - 1;
+
+    // Readable data as at most two contiguous runs (second is empty unless the data wraps around).
+    struct Regions
+    {
+        const T* first;
+        size_t first_len;
+        const T* second;
+        size_t second_len;
+
+        size_t size() const { return first_len + second_len; }
+    };
+
+    // Producer side. Returns 0 on success, -1 if the buffer is full (never with OverwriteOldest).
+    int push(const T& data)
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+
+        // queue is full
+        if (head - tail == CAPACITY)
+        {
+            if constexpr (P == OverflowPolicy::DropNewest)
+            {
+                counters_.add_overruns(1);
+                return -1;
+            }
+            if constexpr (P == OverflowPolicy::Backpressure)
+            {
+                counters_.add_stall();
+                return -1;
+            }
+
+            // Evict the oldest item. If the CAS fails the consumer just freed a slot itself.
+            if (tail_.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel))
+            {
+                counters_.add_overruns(1);
+            }
+        }
+
+        arr_[head & MASK] = data;
+        head_.store(head + 1, std::memory_order_release);
+        counters_.update_level(head + 1 - tail_.load(std::memory_order_relaxed));
+        return 0;
+    }
+
+    // Consumer side. Retrieve value via data. Success if return value is 0.
+    int pop(T* data)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        while (1)
+        {
+            const uint32_t head = head_.load(std::memory_order_acquire);
+
+            // buffer is empty
+            if (head == tail)
+            {
+                counters_.add_underrun();
+                return -1;
+            }
+
+            *data = arr_[tail & MASK];
+            if constexpr (P != OverflowPolicy::OverwriteOldest)
+            {
+                tail_.store(tail + 1, std::memory_order_release);
+                return 0;
+            }
+
+            // Only keep the copy if the producer did not evict the item while we were reading it.
+            // On failure tail is reloaded and we try again with the new oldest item.
+            if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel))
+            {
+                return 0;
+            }
+        }
+    }
+
+    // Producer side. Copy up to n items from data, returns the number of items pushed.
+    size_t push_n(const T* data, size_t n)
+    {
+        // The bulk path must sit in the else branch: code after a discarded if constexpr is still
+        // instantiated
+        if constexpr (P == OverflowPolicy::OverwriteOldest)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                push(data[i]);
+            }
+            return n;
+        }
+        else
+        {
+            const uint32_t head = head_.load(std::memory_order_relaxed);
+            const uint32_t tail = tail_.load(std::memory_order_acquire);
+            const size_t free_slots = CAPACITY - (head - tail);
+            if (n > free_slots)
+            {
+                if constexpr (P == OverflowPolicy::DropNewest)
+                {
+                    counters_.add_overruns(n - free_slots);
+                }
+                else
+                {
+                    counters_.add_stall();
+                }
+                n = free_slots;
+            }
+
+            const size_t idx = head & MASK;
+            const size_t first_len = (n < CAPACITY - idx) ? n : CAPACITY - idx;
+            memcpy(&arr_[idx], data, first_len * sizeof(T));
+            memcpy(&arr_[0], data + first_len, (n - first_len) * sizeof(T));
+            head_.store(head + n, std::memory_order_release);
+            counters_.update_level(head + n - tail);
+            return n;
+        }
+    }
+
+    // Consumer side. Copy up to n items into out, returns the number of items popped.
+    size_t pop_n(T* out, size_t n)
+    {
+        // Item by item under OverwriteOldest, peek_contiguous()/consume() are not available there
+        if constexpr (P == OverflowPolicy::OverwriteOldest)
+        {
+            size_t i = 0;
+            while (i < n && pop(&out[i]) == 0)
+            {
+                i++;
+            }
+            return i;
+        }
+        else
+        {
+            const Regions r = peek_contiguous(n);
+            memcpy(out, r.first, r.first_len * sizeof(T));
+            memcpy(out + r.first_len, r.second, r.second_len * sizeof(T));
+            consume(r.size());
+            if (r.size() < n)
+            {
+                counters_.add_underrun();
+            }
+            return r.size();
+        }
+    }
+
+    // Consumer side. Return up to max_len readable items in place without removing them.
+    // Call consume() once done with (a prefix of) the regions.
+    Regions peek_contiguous(size_t max_len) const
+    {
+        static_assert(P != OverflowPolicy::OverwriteOldest, "in-place reads are not safe against eviction");
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const uint32_t head = head_.load(std::memory_order_acquire);
+        size_t n = head - tail;
+        if (n > max_len)
+        {
+            n = max_len;
+        }
+
+        const size_t idx = tail & MASK;
+        const size_t first_len = (n < CAPACITY - idx) ? n : CAPACITY - idx;
+        return Regions{&arr_[idx], first_len, &arr_[0], n - first_len};
+    }
+
+    // Consumer side. Release n items previously returned by peek_contiguous().
+    void consume(size_t n)
+    {
+        static_assert(P != OverflowPolicy::OverwriteOldest, "in-place reads are not safe against eviction");
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        tail_.store(tail + n, std::memory_order_release);
+    }
+
+    // Number of items currently stored. Exact when called from the producer or consumer,
+    // a snapshot otherwise.
+    size_t size() const
+    {
+        // load tail first so that a concurrent push can only make the result larger, never negative
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        return head_.load(std::memory_order_acquire) - tail;
+    }
+
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() == CAPACITY; }
+
+    // Loss accounting, readable from any context
+    BufferStats stats() const { return counters_.snapshot(); }
+    void reset_stats() { counters_.reset(); }
+
+private:
+    T arr_[N];
+    std::atomic<uint32_t> head_{0}; // next slot to write (producer owned)
+    std::atomic<uint32_t> tail_{0}; // next slot to read (consumer owned, also producer with OverwriteOldest)
+    BufferCounters counters_;
+};
@@ -0,0 +1,55 @@
+/*
+Sample type and the block that carries one window of samples from the acquisition path to the
+processing task.
+
+Several ADC channels can be scanned per tick. Each tick produces one frame of `channels` samples and
+frames are stored interleaved (ch0 ch1 .. chN-1 ch0 ch1 ..), so a block is walked front to back once and
+every channel's accumulator can stay in a register.
+
+Every frame carries the time it was sampled, in microseconds of the esp_timer hardware clock. To keep
+that compact a block stores the timestamp of its first frame and the nominal frame period once, plus a
+16-bit per-frame deviation from the nominal grid (the measured jitter). A frame whose deviation does not
+fit, or a period change, starts a new block.
+
+Samples are unsigned. A filter that removes DC (see filter_bank.h) leaves a signal centred on 0, so the
+filter stage adds a mid-scale offset and records it in the block: the signed value is sample - offset.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef uint16_t sample_t; // analogRead() returns 12-bit values, no need for 32-bit storage
+
+static const uint8_t SAMPLE_MAX_CHANNELS = 8; // max # of ADC channels scanned per tick
+static const uint16_t SAMPLE_BLOCK_MAX = 1024; // max # of samples (all channels) per window, sizes the block storage
+static const uint16_t DEFAULT_WINDOW_LEN = 10; // # of frames averaged per window at boot
+
+// One window of samples, filled in place by the acquisition path and processed in place by the consumer
+struct SampleBlock
+{
+    sample_t samples[SAMPLE_BLOCK_MAX]; // interleaved frames
+    uint16_t len; // # of samples written so far (frames * channels)
+    uint8_t channels; // # of samples per frame
+    uint8_t frac_bits; // fraction bits added by decimation, real ADC counts = sample / 2^frac_bits
+    sample_t offset; // added by the filter stage to a signal centred on 0, 0 for none (same units as samples)
+    uint64_t t0_us; // timestamp of frame 0
+    uint32_t period_ns; // nominal interval between frames
+    int16_t jitter_us[SAMPLE_BLOCK_MAX]; // deviation of each frame from t0_us + i * period_ns
+
+    uint16_t frames() const { return len / channels; }
+
+    // Nominal timestamp of frame i, without its jitter
+    uint64_t grid_us(uint16_t i) const { return t0_us + ((uint64_t)i * period_ns + 500) / 1000; }
+
+    // Measured timestamp of frame i
+    uint64_t timestamp_us(uint16_t i) const { return grid_us(i) + jitter_us[i]; }
+
+    void reset()
+    {
+        len = 0;
+        channels = 1;
+        frac_bits = 0;
+        offset = 0;
+    }
+};
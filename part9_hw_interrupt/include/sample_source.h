@@ -0,0 +1,116 @@
+/*
+Abstract sample source.
+
+A source scans a list of ADC pins and delivers one frame (one sample per pin) per tick to a SampleSink,
+either one frame at a time (timer ISR + analogRead), in DMA-sized blocks (continuous I2S-ADC) or as fast
+as the caller wants (simulation). Frames are interleaved, see sample_block.h.
+The sink may be called from an ISR or from a task, so implementations must be safe in both contexts
+and must not block.
+
+Sources can be re-armed with a new rate while running (set_rate()), and they measure the CPU cycles they
+spend per frame in their own context so callers can check that a requested rate is achievable. The
+measurement is the worst frame since the last begin(), set_pins() or set_rate(), which all start it
+over, so it always describes the config that is running. Until the first frame has been measured a
+conservative estimate per channel stands in for it.
+
+Backends:
+- TimerAdcSource (timer_adc_source.h): hardware timer ISR calling analogRead(), one sample per tick.
+- I2sAdcSource (i2s_adc_source.h): continuous ADC1 sampling through the I2S peripheral and DMA.
+- SimulatedSource (sim_source.h): portable, replays a synthetic or recorded waveform on demand.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "sample_block.h"
+
+class SampleSink
+{
+public:
+    virtual ~SampleSink() {}
+
+    // Deliver frame_cnt consecutive interleaved frames of channels samples each. Frame i was sampled at
+    // timestamp_us + i * period_ns / 1000 (esp_timer microseconds). Called from ISR or task context, must
+    // not block.
+    virtual void on_frames(const sample_t* frames, size_t frame_cnt, uint8_t channels,
+        uint64_t timestamp_us, uint32_t period_ns) = 0;
+};
+
+class SampleSource
+{
+public:
+    virtual ~SampleSource() {}
+
+    // Start delivering frames to sink at rate_hz. Returns false if the rate/config is not supported.
+    virtual bool begin(SampleSink* sink, uint32_t rate_hz) = 0;
+
+    // Stop delivering samples
+    virtual void end() = 0;
+
+    // Change the rate while running, without losing the samples already delivered.
+    // Returns false if the backend cannot run at rate_hz (the old rate stays active).
+    virtual bool set_rate(uint32_t rate_hz) = 0;
+
+    virtual const char* name() const = 0;
+
+    // Most pins the backend can scan per tick
+    virtual uint8_t max_channels() const { return SAMPLE_MAX_CHANNELS; }
+
+    // Pins scanned per tick, in frame order. Only call while stopped (before begin() or after end()).
+    // Returns false if count is 0 or above max_channels().
+    bool set_pins(const int* pins, uint8_t count)
+    {
+        if (count == 0 || count > max_channels())
+        {
+            return false;
+        }
+        for (uint8_t i = 0; i < count; i++)
+        {
+            pins_[i] = pins[i];
+        }
+        channels_ = count;
+        reset_cost();
+        return true;
+    }
+
+    uint8_t channels() const { return channels_; }
+    int pin(uint8_t channel) const { return pins_[channel]; }
+    uint32_t rate() const { return rate_hz_; }
+
+    // Worst CPU cycles per frame seen in the source's own context (ISR or reader task) since the last
+    // reset, or the estimate for the current channel count if nothing has been measured yet
+    uint32_t cycles_per_frame() const
+    {
+        const uint32_t measured = cycles_per_frame_.load(std::memory_order_relaxed);
+        return measured != 0 ? measured : unmeasured_cycles_per_channel() * channels_;
+    }
+    bool cost_measured() const { return cycles_per_frame_.load(std::memory_order_relaxed) != 0; }
+    void reset_cost() { cycles_per_frame_.store(0, std::memory_order_relaxed); }
+
+    static const uint32_t DEFAULT_CYCLES_PER_CHANNEL = 10000; // ~42 us at 240 MHz, well above one analogRead()
+
+protected:
+    // Assumed cost per channel before the first measurement, 0 for a backend that never measures
+    virtual uint32_t unmeasured_cycles_per_channel() const { return DEFAULT_CYCLES_PER_CHANNEL; }
+
+    // Called by the backend after delivering frames. A compare-exchange rather than a plain store, so a
+    // reset_cost() from another task between the load and the store is not undone.
+    void record_cost(uint32_t cycles, size_t frames)
+    {
+        const uint32_t per_frame = cycles / frames;
+        uint32_t seen = cycles_per_frame_.load(std::memory_order_relaxed);
+        while (per_frame > seen && !cycles_per_frame_.compare_exchange_weak(seen, per_frame,
+            std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint32_t rate_hz_ = 0;
+    int pins_[SAMPLE_MAX_CHANNELS] = {};
+    uint8_t channels_ = 0;
+
+private:
+    std::atomic<uint32_t> cycles_per_frame_{0};
+};
@@ -0,0 +1,51 @@
+/*
+Runtime configuration of the sampling pipeline: output sample rate, oversampling and averaging window.
+
+Both can be changed from the CLI task while sampling runs. The rate is applied by re-arming the source,
+the window by the acquisition stage at the block being filled, so the pipeline never stops and no block
+is dropped. A new rate is only accepted if the source's per-frame cost fits in CPU_BUDGET_PCT of one core
+at that rate. The cost is the worst frame measured since the source last (re)started or changed rate or
+pins (so fewer channels raise the limit again), or a conservative estimate until one has been measured.
+
+With oversampling the source runs at rate x ratio and the acquisition stage decimates back down, so the
+budget check is done against the source rate while rate() keeps reporting the output rate.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "acquisition.h"
+#include "sample_source.h"
+
+class SamplerConfig
+{
+public:
+    static const uint8_t CPU_BUDGET_PCT = 50; // max share of a core the source may use for sampling
+
+    SamplerConfig(SampleSource& source, Acquisition& acquisition);
+
+    // Re-arm the source for an output rate of rate_hz. Returns 0 on success, -1 if the source rejects
+    // the rate or the measured cost does not fit the CPU budget.
+    int set_rate(uint32_t rate_hz);
+
+    // Oversample by ratio and decimate with a CIC of the given order (1 = boxcar), keeping the output
+    // rate. ratio 1 turns oversampling off. Returns 0 on success, -1 if rejected (nothing changes).
+    int set_oversampling(uint16_t ratio, uint8_t order);
+    uint16_t oversampling_ratio() const { return acquisition_.decimation_ratio(); }
+    uint8_t oversampling_order() const { return acquisition_.decimation_order(); }
+
+    // Frames per block, i.e. how often the moving average is reported. Returns 0 on success, -1 if out of range.
+    int set_window_len(uint16_t len) { return acquisition_.set_window_len(len); }
+
+    uint32_t rate() const { return source_.rate() / acquisition_.decimation_ratio(); }
+    uint16_t window_len() const { return acquisition_.window_len(); }
+
+    // Highest output rate the cost allows within the budget at the given oversampling ratio, 0 for no
+    // limit (a source without a cost, the simulation)
+    uint32_t max_rate_hz(uint16_t ratio) const;
+    uint32_t max_rate_hz() const { return max_rate_hz(oversampling_ratio()); }
+
+private:
+    SampleSource& source_;
+    Acquisition& acquisition_;
+};
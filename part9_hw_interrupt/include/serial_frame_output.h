@@ -0,0 +1,22 @@
+/*
+FrameOutput on an Arduino serial port. What fits without blocking is the free space of the UART driver's
+TX ring buffer plus the hardware FIFO, so give the port a TX buffer of at least one full frame with
+setTxBufferSize() before begin().
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "frame_output.h"
+
+class SerialFrameOutput : public FrameOutput
+{
+public:
+    explicit SerialFrameOutput(HardwareSerial& serial) : serial_(serial) {}
+
+    size_t available_for_write() override { return serial_.availableForWrite(); }
+    void write(const uint8_t* data, size_t len) override { serial_.write(data, len); }
+
+private:
+    HardwareSerial& serial_;
+};
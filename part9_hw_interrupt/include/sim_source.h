@@ -0,0 +1,64 @@
+/*
+Simulated sample source for running the pipeline without a board.
+
+Generates a sine wave with offset and uniform noise on every channel (each channel phase shifted by
+1/channels of a period), or replays a recorded buffer of interleaved frames in a loop. Pins are ignored,
+only their count matters; a recording fixes the count to its own channel count, and begin() refuses any
+other. There is no clock behind it: the caller decides the pace by calling pump(), either from a
+periodic task on target or in a tight loop on a Linux host to benchmark the downstream stages. Its cost
+is not measured, and its timestamps come from a virtual clock that starts at 0 and advances exactly one
+period per frame. The noise generator is a fixed-seed LCG so every run produces the same samples.
+Portable C++, no Arduino or FreeRTOS dependency.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sample_source.h"
+
+struct SimWaveform
+{
+    float offset; // DC level in ADC counts
+    float amplitude; // sine amplitude in ADC counts
+    float freq_hz; // sine frequency
+    float noise; // peak uniform noise in ADC counts
+};
+
+class SimulatedSource : public SampleSource
+{
+public:
+    explicit SimulatedSource(const SimWaveform& wave);
+    // frame_cnt frames of channels interleaved samples each
+    SimulatedSource(const sample_t* recording, size_t frame_cnt, uint8_t channels);
+
+    bool begin(SampleSink* sink, uint32_t rate_hz) override;
+    void end() override;
+    bool set_rate(uint32_t rate_hz) override;
+    const char* name() const override { return "sim"; }
+    uint8_t max_channels() const override { return recording_ != NULL ? recording_channels_ : SAMPLE_MAX_CHANNELS; }
+
+    // Generate the next n frames and deliver them to the sink. Returns the number of frames delivered.
+    size_t pump(size_t n);
+
+    static const size_t CHUNK_LEN = 64; // max frames per on_frames() call
+    static const sample_t ADC_MAX = 4095; // 12-bit ADC full scale
+
+protected:
+    uint32_t unmeasured_cycles_per_channel() const override { return 0; } // no cost, no rate limit
+
+private:
+    void next_frame(sample_t* frame);
+    sample_t synth(float phase);
+
+    const SimWaveform wave_;
+    const sample_t* const recording_;
+    const size_t recording_len_; // in frames
+    const uint8_t recording_channels_;
+    size_t recording_pos_ = 0;
+    SampleSink* sink_ = NULL;
+    float phase_step_ = 0.f; // radians per sample
+    float phase_ = 0.f;
+    uint32_t rng_ = 1;
+    uint64_t clock_ns_ = 0; // virtual time of the next frame
+};
@@ -0,0 +1,105 @@
+/*
+Tear-free publication of a result struct from one writer task to any number of readers on either core.
+
+Two copies of the value, each guarded by a sequence counter (a seqlock per copy), plus a generation
+counter that says which copy is the latest:
+- publish() writes into the copy readers are not pointed at, with its sequence odd while writing, then
+  bumps the generation so readers switch over. It never waits for readers.
+- read() copies the latest copy and checks its sequence did not change meanwhile, retrying otherwise.
+A reader only has to retry if the writer publishes twice during one read, which needs the writer to run
+on the other core. A reader that preempts the writer on the same core always finds the published copy
+untouched, so it can never spin on a writer that cannot run. Nothing blocks and interrupts stay
+enabled, so it also works from an ISR.
+
+The value is stored as relaxed atomic words, so the racing copies are well defined in C++.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+template <typename T>
+class Snapshot
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot values are copied word by word");
+
+public:
+    Snapshot()
+    {
+        T empty;
+        memset(&empty, 0, sizeof(empty));
+        store(0, empty);
+        store(1, empty);
+    }
+
+    // Single writer
+    void publish(const T& value)
+    {
+        const uint32_t next = (generation_.load(std::memory_order_relaxed) + 1) & 1;
+        const uint32_t seq = seq_[next].load(std::memory_order_relaxed);
+        seq_[next].store(seq + 1, std::memory_order_relaxed); // odd: being written
+        std::atomic_thread_fence(std::memory_order_release);
+        store(next, value);
+        seq_[next].store(seq + 2, std::memory_order_release);
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+
+    // Any reader, never blocks the writer. Returns the generation of the copy read (0 = never published).
+    uint32_t read(T* value) const
+    {
+        while (1)
+        {
+            const uint32_t gen = generation_.load(std::memory_order_acquire);
+            const uint32_t idx = gen & 1;
+            const uint32_t seq = seq_[idx].load(std::memory_order_acquire);
+            if (seq & 1)
+            {
+                continue; // overtaken twice, the generation has moved on
+            }
+            load(idx, value);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_[idx].load(std::memory_order_relaxed) == seq)
+            {
+                return gen;
+            }
+        }
+    }
+
+    // Number of publish() calls so far
+    uint32_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    // Word by word, without a temporary copy of T on the stack
+    void store(uint32_t idx, const T& value)
+    {
+        const uint8_t* bytes = (const uint8_t*)&value;
+        for (size_t i = 0; i < WORDS; i++)
+        {
+            uint32_t word = 0;
+            memcpy(&word, bytes + i * 4, chunk(i));
+            data_[idx][i].store(word, std::memory_order_relaxed);
+        }
+    }
+
+    void load(uint32_t idx, T* value) const
+    {
+        uint8_t* bytes = (uint8_t*)value;
+        for (size_t i = 0; i < WORDS; i++)
+        {
+            const uint32_t word = data_[idx][i].load(std::memory_order_relaxed);
+            memcpy(bytes + i * 4, &word, chunk(i));
+        }
+    }
+
+    // Bytes of T in word i, the last word may be partial
+    static size_t chunk(size_t i) { return i + 1 < WORDS ? 4 : sizeof(T) - i * 4; }
+
+    std::atomic<uint32_t> generation_{0};
+    std::atomic<uint32_t> seq_[2] = {};
+    std::atomic<uint32_t> data_[2][WORDS];
+};
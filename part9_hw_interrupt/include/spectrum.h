@@ -0,0 +1,92 @@
+/*
+Block FFT stage: windowed real FFT over consecutive frames of one channel, plus spectral peak picking.
+
+Frames of the selected channel are collected from consecutive blocks until size() samples are in,
+then the frame's mean is removed, a Hann or Hamming window applied and a real FFT of size 64..MAX_SIZE
+(power of two) computed as a complex FFT of half the size plus a split step. The magnitude spectrum is
+scaled so a sine of amplitude A shows up as A ADC counts, and its largest local maxima (with parabolic
+interpolation between bins) are kept as peaks(). Frames do not overlap.
+
+All memory is a fixed arena sized for MAX_SIZE at compile time: the collection buffer, the FFT work
+buffer, the magnitude spectrum and one quarter-wave sine table shared by the window and the twiddle
+factors. Nothing is allocated per frame.
+
+Size 0 turns the stage off: push_block() returns right away and no floating point is used, so an
+integer-only consumer can keep the FFT compiled in and turn it on when needed.
+
+Owned by the consumer task. set_config() may be called from any task; the new config is applied at
+the next push_block(), which restarts collection. So does a change of block layout or frame period.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include "sample_block.h"
+
+enum class FftWindow : uint8_t
+{
+    Hann,
+    Hamming,
+};
+
+struct SpectralPeak
+{
+    float freq_hz;
+    float magnitude; // sine amplitude in ADC counts
+};
+
+class SpectrumAnalyzer
+{
+public:
+    static const uint16_t MIN_SIZE = 64;
+    static const uint16_t MAX_SIZE = 4096;
+    static const uint8_t MAX_PEAKS = 8;
+
+    explicit SpectrumAnalyzer(uint16_t size);
+
+    // Any task. size must be 0 (off) or a power of two in MIN_SIZE..MAX_SIZE. Returns 0 on success, -1
+    // otherwise.
+    int set_config(uint16_t size, FftWindow window, uint8_t channel);
+    uint16_t size() const { return config_.load(std::memory_order_relaxed) & 0xFFFF; }
+    FftWindow window() const { return (FftWindow)((config_.load(std::memory_order_relaxed) >> 16) & 0xFF); }
+    uint8_t channel() const { return config_.load(std::memory_order_relaxed) >> 24; }
+
+    // Consumer side. Collect the selected channel, runs an FFT whenever a frame is complete.
+    void push_block(const SampleBlock& block);
+
+    // Result of the last FFT
+    uint32_t frame_count() const { return frames_done_; } // FFTs computed since the last restart
+    float bin_hz() const { return bin_hz_; }
+    const float* magnitudes() const { return mag_; } // size() / 2 + 1 bins
+    uint8_t peak_count() const { return peak_cnt_; }
+    const SpectralPeak& peak(uint8_t i) const { return peaks_[i]; } // largest first
+
+private:
+    void restart(const SampleBlock& block, uint32_t config);
+    void compute();
+    void find_peaks(uint16_t bins);
+
+    // sin/cos of 2*pi*j/MAX_SIZE from the quarter-wave table
+    float sin_lut(uint32_t j) const;
+    float cos_lut(uint32_t j) const { return sin_lut(j + MAX_SIZE / 4); }
+
+    std::atomic<uint32_t> config_; // size | window << 16 | channel << 24
+
+    // Consumer owned
+    uint32_t applied_config_ = 0;
+    uint8_t channels_ = 0;
+    uint8_t frac_bits_ = 0;
+    uint32_t period_ns_ = 0;
+    uint16_t fill_ = 0;
+    uint32_t frames_done_ = 0;
+    float bin_hz_ = 0.f;
+    uint8_t peak_cnt_ = 0;
+    SpectralPeak peaks_[MAX_PEAKS] = {};
+
+    // Arena
+    float in_[MAX_SIZE]; // samples of the frame being collected, ADC counts
+    float work_[MAX_SIZE]; // MAX_SIZE / 2 complex values, re/im interleaved
+    float mag_[MAX_SIZE / 2 + 1];
+    float sin_table_[MAX_SIZE / 4 + 1];
+};
@@ -0,0 +1,21 @@
+/*
+Notifier backed by a FreeRTOS direct-to-task notification (eSetBits), usable from ISR or task context.
+The task waits with xTaskNotifyWait() to get the bits, or ulTaskNotifyTake() if it only needs the wake-up.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "notifier.h"
+
+class TaskNotifier : public Notifier
+{
+public:
+    // Task to wake. Must be set before anything can notify.
+    void begin(TaskHandle_t task) { task_ = task; }
+
+    void notify(uint32_t bits) override;
+
+private:
+    TaskHandle_t task_ = NULL;
+};
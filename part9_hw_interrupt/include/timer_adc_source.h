@@ -0,0 +1,57 @@
+/*
+Sample source driven by a hardware timer: the ISR reads one frame with analogRead() per alarm,
+one conversion per configured pin.
+The ISR measures its own cost with the CPU cycle counter.
+
+The ISR also keeps timing histograms (see timing()), all in CPU cycles:
+- latency: alarm to ISR entry, from the timer count at entry (the counter auto-reloads to 0 on the alarm,
+  so its value is the time since the alarm, in 25ns ticks),
+- exec: ISR entry to exit,
+- jitter: how far the interval between two ISR entries is off the nominal period (either direction).
+
+analogRead() costs tens of microseconds, so this backend is limited to low sample rates. Only one
+instance can be active at a time because the Arduino timer API has no ISR argument.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "isr_histogram.h"
+#include "sample_source.h"
+
+struct IsrTiming
+{
+    IsrHistogram<4, 64> latency; // 16 cycle buckets, up to ~4us at 240MHz
+    IsrHistogram<10, 64> exec; // 1024 cycle buckets, up to ~270us at 240MHz (an 8 channel scan)
+    IsrHistogram<4, 64> jitter; // 16 cycle buckets, up to ~4us at 240MHz
+};
+
+class TimerAdcSource : public SampleSource
+{
+public:
+    explicit TimerAdcSource(uint8_t timer_id);
+
+    bool begin(SampleSink* sink, uint32_t rate_hz) override;
+    void end() override;
+    bool set_rate(uint32_t rate_hz) override;
+    const char* name() const override { return "timer"; }
+
+    // ISR timing histograms, readable from any task
+    const IsrTiming& timing() const { return timing_; }
+    void reset_timing();
+
+private:
+    static void IRAM_ATTR onTimer();
+
+    static TimerAdcSource* active_; // instance serviced by onTimer
+
+    const uint8_t timer_id_;
+    hw_timer_t* timer_ = NULL;
+    SampleSink* sink_ = NULL;
+
+    IsrTiming timing_;
+    uint32_t cycles_per_tick_ = 0; // CPU cycles per timer tick
+    uint32_t period_cycles_ = 0; // nominal ISR interval
+    uint32_t last_entry_ = 0; // cycle count at the previous ISR entry
+    bool have_last_entry_ = false; // false until the first ISR after (re)arming
+};
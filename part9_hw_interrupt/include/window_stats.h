@@ -0,0 +1,153 @@
+/*
+Per-channel window statistics in a single pass over a block of interleaved frames: count, min, max,
+mean, variance/stddev and RMS.
+
+Every metric comes from integer accumulators (min, max, sum, sum of squares). Samples are at most 16
+bits and a block holds at most SAMPLE_BLOCK_MAX of them, so the sums are exact in 32/64 bits and the
+variance n*sum_sq - sum^2 is computed exactly in integers before the single conversion to float. That
+needs no division per sample (unlike Welford's update) and cannot lose precision the way the naive
+float formula does, because nothing is rounded until the very end.
+
+Metrics are chosen with a compile-time mask (STAT_*). Accumulators for disabled metrics are dropped
+from the loop by if constexpr, so unused metrics cost nothing. Variance/stddev and RMS share the sum of
+squares, mean and RMS share the sum.
+
+Blocks from a DC-blocking filter carry a mid-scale offset (SampleBlock::offset). The accumulators stay
+on the raw samples; min, max, mean and RMS subtract the offset when derived, RMS exactly in integers
+from the sum and sum of squares. Variance does not depend on the offset.
+
+The channel count is turned into a template parameter through a switch, so the accumulators are a
+fixed-size local array the compiler can keep in registers and the inner loop fully unrolls.
+*/
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include "sample_block.h"
+
+enum StatMetric : uint8_t
+{
+    STAT_MIN = 1 << 0,
+    STAT_MAX = 1 << 1,
+    STAT_MEAN = 1 << 2,
+    STAT_VARIANCE = 1 << 3, // also stddev
+    STAT_RMS = 1 << 4,
+    STAT_ALL = 0x1F,
+};
+
+// Accumulated over one window of one channel, in units of 2^-frac_bits ADC counts
+struct ChannelStats
+{
+    uint32_t count;
+    uint8_t frac_bits;
+    sample_t offset; // from the block, subtracted by the derived values
+    sample_t min;
+    sample_t max;
+    uint32_t sum; // < SAMPLE_BLOCK_MAX * 2^16
+    uint64_t sum_sq; // < SAMPLE_BLOCK_MAX * 2^32
+
+    // Derived values in ADC counts, only valid for the metrics that were accumulated
+    float scale() const { return 1.f / (1u << frac_bits); }
+    float min_counts() const { return ((int32_t)min - offset) * scale(); }
+    float max_counts() const { return ((int32_t)max - offset) * scale(); }
+    float mean() const { return count == 0 ? 0.f : ((float)sum / count - offset) * scale(); }
+
+    // Population variance, exact in integers up to the final division
+    float variance() const
+    {
+        if (count == 0)
+        {
+            return 0.f;
+        }
+        uint64_t n_var = (uint64_t)count * sum_sq - (uint64_t)sum * sum; // n^2 * variance
+        return (float)n_var / ((float)count * count) * scale() * scale();
+    }
+    float stddev() const { return sqrtf(variance()); }
+    float rms() const
+    {
+        if (count == 0)
+        {
+            return 0.f;
+        }
+        // sum of (s - offset)^2, never negative
+        const uint64_t centred = sum_sq + (uint64_t)count * offset * offset - 2ull * offset * sum;
+        return sqrtf((float)centred / count) * scale();
+    }
+};
+
+template <uint8_t METRICS, uint8_t C>
+inline void window_stats_n(const sample_t* samples, uint16_t frames, ChannelStats* out)
+{
+    constexpr bool need_sum = (METRICS & (STAT_MEAN | STAT_VARIANCE | STAT_RMS)) != 0;
+    constexpr bool need_sum_sq = (METRICS & (STAT_VARIANCE | STAT_RMS)) != 0;
+
+    sample_t lo[C];
+    sample_t hi[C];
+    uint32_t sum[C] = {};
+    uint64_t sum_sq[C] = {};
+    for (uint8_t c = 0; c < C; c++)
+    {
+        lo[c] = UINT16_MAX;
+        hi[c] = 0;
+    }
+
+    for (uint16_t f = 0; f < frames; f++, samples += C)
+    {
+        for (uint8_t c = 0; c < C; c++)
+        {
+            const sample_t s = samples[c];
+            if constexpr ((METRICS & STAT_MIN) != 0)
+            {
+                lo[c] = s < lo[c] ? s : lo[c];
+            }
+            if constexpr ((METRICS & STAT_MAX) != 0)
+            {
+                hi[c] = s > hi[c] ? s : hi[c];
+            }
+            if constexpr (need_sum)
+            {
+                sum[c] += s;
+            }
+            if constexpr (need_sum_sq)
+            {
+                sum_sq[c] += (uint32_t)s * s;
+            }
+        }
+    }
+
+    for (uint8_t c = 0; c < C; c++)
+    {
+        out[c].count = frames;
+        out[c].min = lo[c];
+        out[c].max = hi[c];
+        out[c].sum = sum[c];
+        out[c].sum_sq = sum_sq[c];
+    }
+}
+
+// out must hold block.channels entries
+template <uint8_t METRICS>
+inline void window_stats(const SampleBlock& block, ChannelStats* out)
+{
+    const uint16_t frames = block.frames();
+    switch (block.channels)
+    {
+        case 1: window_stats_n<METRICS, 1>(block.samples, frames, out); break;
+        case 2: window_stats_n<METRICS, 2>(block.samples, frames, out); break;
+        case 3: window_stats_n<METRICS, 3>(block.samples, frames, out); break;
+        case 4: window_stats_n<METRICS, 4>(block.samples, frames, out); break;
+        case 5: window_stats_n<METRICS, 5>(block.samples, frames, out); break;
+        case 6: window_stats_n<METRICS, 6>(block.samples, frames, out); break;
+        case 7: window_stats_n<METRICS, 7>(block.samples, frames, out); break;
+        case 8: window_stats_n<METRICS, 8>(block.samples, frames, out); break;
+    }
+    for (uint8_t c = 0; c < block.channels; c++)
+    {
+        out[c].frac_bits = block.frac_bits;
+        out[c].offset = block.offset;
+    }
+}
+
+static_assert(SAMPLE_MAX_CHANNELS == 8, "window_stats() needs a case per channel count");
+static_assert(SAMPLE_BLOCK_MAX <= 65536, "window sums must stay exact in 32 bits");
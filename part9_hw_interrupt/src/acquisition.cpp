@@ -0,0 +1,155 @@
+#include "acquisition.h"
+
+#include "platform.h"
+
+void IRAM_ATTR Acquisition::on_frames(const sample_t* frames, size_t frame_cnt, uint8_t channels,
+    uint64_t timestamp_us, uint32_t period_ns)
+{
+    uint32_t published = 0; // bit per block index handed over during this call
+    const uint16_t window_len = window_len_.load(std::memory_order_relaxed);
+
+    // Restart the decimators if the config or the channel count changed since the last call, so every
+    // channel starts a new output at the same frame and none carries state from another pin
+    const uint32_t decim_cfg = decim_cfg_.load(std::memory_order_relaxed);
+    if (decim_cfg != decim_applied_ || channels != decim_channels_)
+    {
+        for (uint8_t c = 0; c < SAMPLE_MAX_CHANNELS; c++)
+        {
+            decim_[c].configure(decim_cfg & 0xFFFF, decim_cfg >> 16);
+        }
+        decim_applied_ = decim_cfg;
+        decim_channels_ = channels;
+    }
+    const bool decimate = decim_[0].ratio() > 1;
+    const uint8_t frac_bits = decim_[0].extra_bits();
+    uint64_t out_period_ns = (uint64_t)period_ns * decim_[0].ratio();
+    if (out_period_ns > UINT32_MAX)
+    {
+        out_period_ns = UINT32_MAX;
+    }
+
+    for (size_t f = 0; f < frame_cnt; f++)
+    {
+        const sample_t* frame = &frames[f * channels];
+        const uint64_t frame_us = timestamp_us + ((uint64_t)f * period_ns + 500) / 1000;
+
+        // Events are detected on every acquired frame, ahead of decimation and block handover
+        detector_.check(frame, channels, frame_us);
+
+        // Oversampling: only every ratio-th input frame yields a (decimated) output frame
+        sample_t decimated[SAMPLE_MAX_CHANNELS];
+        if (decimate)
+        {
+            bool ready = true;
+            for (uint8_t c = 0; c < channels; c++)
+            {
+                ready = decim_[c].push(frame[c], &decimated[c]) && ready;
+            }
+            if (!ready)
+            {
+                continue;
+            }
+            frame = decimated;
+        }
+
+        // NULL while a full block is held back by backpressure, retry handing it over first
+        SampleBlock* block = blocks_.write_block();
+        if (block == NULL)
+        {
+            const int idx = blocks_.publish();
+            if (idx < 0)
+            {
+                continue; // frame skipped, the stall is counted by the buffer
+            }
+            published |= 1u << idx;
+            block = blocks_.write_block();
+        }
+
+        // Never mix frame layouts or time bases in one block, hand over what we have first
+        if (!fits_block(*block, channels, frac_bits, out_period_ns, frame_us))
+        {
+            const int idx = blocks_.publish();
+            if (idx >= 0)
+            {
+                published |= 1u << idx;
+            }
+            block = blocks_.write_block();
+            if (block == NULL)
+            {
+                continue;
+            }
+        }
+
+        if (block->len == 0)
+        {
+            block->channels = channels;
+            block->frac_bits = frac_bits;
+            block->t0_us = frame_us;
+            block->period_ns = out_period_ns;
+        }
+        const uint16_t frame_idx = block->frames();
+        block->jitter_us[frame_idx] = (int16_t)(frame_us - block->grid_us(frame_idx));
+        for (uint8_t c = 0; c < channels; c++)
+        {
+            block->samples[block->len + c] = frame[c];
+        }
+        block->len += channels;
+
+        // Once the block holds a window (or cannot take another frame), hand it to the task and switch
+        // to the next one. If the task is behind, the overflow policy decides what is lost and counts it.
+        if (block->frames() >= window_len || block->len + channels > SAMPLE_BLOCK_MAX)
+        {
+            const int idx = blocks_.publish();
+            if (idx >= 0)
+            {
+                published |= 1u << idx;
+            }
+        }
+    }
+
+    // One notification per call however many blocks were published, the consumer drains them all per
+    // wake. The published block indices are OR-ed into the notification value.
+    if (published != 0 && consumer_ != NULL)
+    {
+        consumer_->notify(published);
+    }
+}
+
+// True if a frame with this layout and timestamp can go into block
+bool IRAM_ATTR Acquisition::fits_block(const SampleBlock& block, uint8_t channels, uint8_t frac_bits,
+    uint32_t period_ns, uint64_t timestamp_us)
+{
+    if (block.len == 0)
+    {
+        return true;
+    }
+    if (block.channels != channels || block.frac_bits != frac_bits || block.period_ns != period_ns)
+    {
+        return false;
+    }
+
+    int64_t jitter = (int64_t)(timestamp_us - block.grid_us(block.frames()));
+    return jitter >= INT16_MIN && jitter <= INT16_MAX;
+}
+
+int Acquisition::set_window_len(uint16_t len)
+{
+    if (len == 0 || len > SAMPLE_BLOCK_MAX)
+    {
+        return -1;
+    }
+
+    window_len_.store(len, std::memory_order_relaxed);
+    return 0;
+}
+
+int Acquisition::set_decimation(uint16_t ratio, uint8_t order)
+{
+    if (CicDecimator::check(ratio, order) != 0)
+    {
+        return -1;
+    }
+
+    decim_cfg_.store(ratio | (uint32_t)order << 16, std::memory_order_relaxed);
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "event_detector.h"
+
+#include "platform.h"
+
+int EventDetector::set_rule(uint8_t channel, const Rule& rule)
+{
+    if (channel >= SAMPLE_MAX_CHANNELS || (rule.high != 0 && rule.low >= rule.high))
+    {
+        return -1;
+    }
+
+    max_step_[channel].store(rule.max_step, std::memory_order_relaxed);
+    levels_[channel].store(rule.high | (uint32_t)rule.low << 16, std::memory_order_relaxed);
+    return 0;
+}
+
+EventDetector::Rule EventDetector::rule(uint8_t channel) const
+{
+    const uint32_t levels = levels_[channel].load(std::memory_order_relaxed);
+    return Rule{(sample_t)(levels & 0xFFFF), (sample_t)(levels >> 16), max_step_[channel].load(std::memory_order_relaxed)};
+}
+
+void IRAM_ATTR EventDetector::check(const sample_t* frame, uint8_t channels, uint64_t timestamp_us)
+{
+    if (channels != channels_)
+    {
+        channels_ = channels;
+        primed_ = false;
+        for (uint8_t c = 0; c < SAMPLE_MAX_CHANNELS; c++)
+        {
+            level_[c] = Level::Unknown;
+        }
+    }
+
+    for (uint8_t c = 0; c < channels; c++)
+    {
+        const sample_t x = frame[c];
+
+        const uint32_t levels = levels_[c].load(std::memory_order_relaxed);
+        if (levels != applied_levels_[c])
+        {
+            applied_levels_[c] = levels;
+            level_[c] = Level::Unknown;
+        }
+        const sample_t high = levels & 0xFFFF;
+        const sample_t low = levels >> 16;
+        if (high != 0)
+        {
+            // Only a crossing from the opposite state fires, Unknown just takes the state on. A start inside
+            // the band counts as low, so the first rise through high fires; only a start at or above high
+            // stays quiet.
+            if (x >= high && level_[c] != Level::High)
+            {
+                if (level_[c] == Level::Low)
+                {
+                    fire(c, EventKind::Rising, x, timestamp_us);
+                }
+                level_[c] = Level::High;
+            }
+            else if (x <= low && level_[c] != Level::Low)
+            {
+                if (level_[c] == Level::High)
+                {
+                    fire(c, EventKind::Falling, x, timestamp_us);
+                }
+                level_[c] = Level::Low;
+            }
+            else if (level_[c] == Level::Unknown)
+            {
+                level_[c] = Level::Low;
+            }
+        }
+
+        const uint16_t max_step = max_step_[c].load(std::memory_order_relaxed);
+        if (max_step != 0 && primed_)
+        {
+            const int32_t step = (int32_t)x - prev_[c];
+            if (step > max_step || -step > max_step)
+            {
+                fire(c, EventKind::Slope, x, timestamp_us);
+            }
+        }
+        prev_[c] = x;
+    }
+    primed_ = true;
+}
+
+// Queue the event and wake the handler right away, not at the end of the block
+void IRAM_ATTR EventDetector::fire(uint8_t channel, EventKind kind, sample_t value, uint64_t timestamp_us)
+{
+    const DetectorEvent event = {timestamp_us, cycle_count(), value, channel, kind};
+    if (events_.push(event) != 0 || handler_ == NULL)
+    {
+        return; // handler behind, counted by the ring
+    }
+    handler_->notify(1); // from an ISR this switches to the handler as soon as the ISR returns
+}
@@ -0,0 +1,258 @@
+#include "filter_bank.h"
+
+#include <math.h>
+#include <string.h>
+
+#if __has_include(<esp_dsp.h>)
+#include <esp_dsp.h>
+#define FILTER_HAS_ESP_DSP 1
+#else
+#define FILTER_HAS_ESP_DSP 0
+#endif
+
+FilterBank::FilterBank()
+    : backend_(FILTER_HAS_ESP_DSP ? Backend::EspDsp : Backend::Portable)
+{
+    memset(&staged_, 0, sizeof(staged_));
+    memset(&active_, 0, sizeof(active_));
+    reset_state();
+}
+
+bool FilterBank::has_esp_dsp()
+{
+    return FILTER_HAS_ESP_DSP;
+}
+
+void FilterBank::fir(Backend backend, const float* fir_rev, uint8_t taps, float* history, float* x, uint16_t len)
+{
+    const uint8_t hist_len = taps - 1;
+
+#if FILTER_HAS_ESP_DSP
+    if (backend == Backend::EspDsp)
+    {
+        // esp-dsp keeps the last taps inputs in a circular delay line. Its first call writes the new input
+        // at delay[0] and reads the older ones from delay[1..taps-1], oldest first.
+        float delay[FIR_MAX_TAPS];
+        fir_f32_t state;
+        dsps_fir_init_f32(&state, (float*)fir_rev, delay, taps);
+        memcpy(&delay[1], history, hist_len * sizeof(float));
+        state.pos = 0;
+        dsps_fir_f32(&state, x, x, len);
+
+        // Newest input sits at delay[pos - 1], so the oldest of the last taps-1 is at pos + 1
+        for (uint8_t i = 0; i < hist_len; i++)
+        {
+            history[i] = delay[(state.pos + 1 + i) % taps];
+        }
+        return;
+    }
+#else
+    (void)backend;
+#endif
+
+    // Inputs the next block needs, saved before the loop below overwrites x
+    float next_history[FIR_MAX_TAPS - 1];
+    if (len >= hist_len)
+    {
+        memcpy(next_history, &x[len - hist_len], hist_len * sizeof(float));
+    }
+    else
+    {
+        memcpy(next_history, &history[len], (hist_len - len) * sizeof(float));
+        memcpy(&next_history[hist_len - len], x, len * sizeof(float));
+    }
+
+    // In place from the back: y[n] only needs x[n - taps + 1 .. n], none of which is overwritten yet.
+    // Where the window is inside the block the dot product runs over two contiguous arrays.
+    int32_t n = len - 1;
+    for (; n >= hist_len; n--)
+    {
+        const float* window = &x[n - hist_len];
+        float acc = 0.f;
+        for (uint8_t k = 0; k < taps; k++)
+        {
+            acc += fir_rev[k] * window[k];
+        }
+        x[n] = acc;
+    }
+    // The first taps-1 outputs reach back into the previous block
+    for (; n >= 0; n--)
+    {
+        const uint8_t from_history = hist_len - n;
+        float acc = 0.f;
+        for (uint8_t k = 0; k < from_history; k++)
+        {
+            acc += fir_rev[k] * history[n + k];
+        }
+        for (uint8_t k = from_history; k < taps; k++)
+        {
+            acc += fir_rev[k] * x[k - from_history];
+        }
+        x[n] = acc;
+    }
+
+    memcpy(history, next_history, hist_len * sizeof(float));
+}
+
+void FilterBank::biquad(Backend backend, const float* coefs, float* w, float* x, uint16_t len)
+{
+#if FILTER_HAS_ESP_DSP
+    if (backend == Backend::EspDsp)
+    {
+        dsps_biquad_f32(x, x, len, (float*)coefs, w);
+        return;
+    }
+#else
+    (void)backend;
+#endif
+
+    // Direct form II, same arithmetic as dsps_biquad_f32
+    const float b0 = coefs[0], b1 = coefs[1], b2 = coefs[2], a1 = coefs[3], a2 = coefs[4];
+    float w0 = w[0], w1 = w[1];
+    for (uint16_t i = 0; i < len; i++)
+    {
+        const float d0 = x[i] - a1 * w0 - a2 * w1;
+        x[i] = b0 * d0 + b1 * w0 + b2 * w1;
+        w1 = w0;
+        w0 = d0;
+    }
+    w[0] = w0;
+    w[1] = w1;
+}
+
+int FilterBank::set_fir(const float* taps, uint8_t count)
+{
+    if (count > FIR_MAX_TAPS || staged_ready_.load(std::memory_order_acquire))
+    {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        staged_.fir_rev[count - 1 - i] = taps[i];
+    }
+    staged_.fir_taps = count;
+    staged_ready_.store(true, std::memory_order_release);
+    return 0;
+}
+
+int FilterBank::set_biquads(const float* coefs, uint8_t stages)
+{
+    if (stages > BIQUAD_MAX_STAGES || staged_ready_.load(std::memory_order_acquire))
+    {
+        return -1;
+    }
+
+    memcpy(staged_.biquad, coefs, stages * BIQUAD_COEFS * sizeof(float));
+    staged_.stages = stages;
+    staged_ready_.store(true, std::memory_order_release);
+    return 0;
+}
+
+int FilterBank::clear()
+{
+    if (staged_ready_.load(std::memory_order_acquire))
+    {
+        return -1;
+    }
+
+    staged_.fir_taps = 0;
+    staged_.stages = 0;
+    staged_ready_.store(true, std::memory_order_release);
+    return 0;
+}
+
+int FilterBank::set_backend(Backend backend)
+{
+    if (backend == Backend::EspDsp && !has_esp_dsp())
+    {
+        return -1;
+    }
+
+    backend_.store(backend, std::memory_order_relaxed);
+    return 0;
+}
+
+// Gain at 0 Hz of the whole chain: the sum of the FIR taps times (b0 + b1 + b2) / (1 + a1 + a2) per biquad
+float FilterBank::dc_gain(const Config& config)
+{
+    float gain = 1.f;
+    if (config.fir_taps > 0)
+    {
+        float sum = 0.f;
+        for (uint8_t k = 0; k < config.fir_taps; k++)
+        {
+            sum += config.fir_rev[k];
+        }
+        gain = sum;
+    }
+    for (uint8_t s = 0; s < config.stages; s++)
+    {
+        const float* c = config.biquad[s];
+        const float den = 1.f + c[3] + c[4];
+        if (den == 0.f)
+        {
+            return gain == 0.f ? 0.f : INFINITY; // pole at DC, an integrator never goes negative on its own
+        }
+        gain *= (c[0] + c[1] + c[2]) / den;
+    }
+    return gain;
+}
+
+void FilterBank::reset_state()
+{
+    memset(fir_history_, 0, sizeof(fir_history_));
+    memset(biquad_w_, 0, sizeof(biquad_w_));
+}
+
+void FilterBank::process(SampleBlock& block)
+{
+    if (staged_ready_.load(std::memory_order_acquire))
+    {
+        active_ = staged_;
+        active_offset_ = dc_gain(active_) < 0.5f;
+        staged_ready_.store(false, std::memory_order_release);
+        reset_state();
+    }
+    if (block.channels != channels_ || block.frac_bits != frac_bits_)
+    {
+        channels_ = block.channels;
+        frac_bits_ = block.frac_bits;
+        reset_state();
+    }
+    if (active_.fir_taps == 0 && active_.stages == 0)
+    {
+        return;
+    }
+
+    // A DC-blocking design swings around 0, lift it to mid-scale so both half-cycles fit
+    const float offset = active_offset_ ? (float)(MID_SCALE << block.frac_bits) : 0.f;
+    block.offset = (sample_t)offset;
+
+    const Backend backend = backend_.load(std::memory_order_relaxed);
+    const uint8_t channels = block.channels;
+    const uint16_t frames = block.frames();
+    for (uint8_t c = 0; c < channels; c++)
+    {
+        for (uint16_t f = 0; f < frames; f++)
+        {
+            work_[f] = block.samples[f * channels + c];
+        }
+
+        if (active_.fir_taps > 0)
+        {
+            fir(backend, active_.fir_rev, active_.fir_taps, fir_history_[c], work_, frames);
+        }
+        for (uint8_t s = 0; s < active_.stages; s++)
+        {
+            biquad(backend, active_.biquad[s], biquad_w_[c][s], work_, frames);
+        }
+
+        // Back into the block, rounded and clamped to the sample range
+        for (uint16_t f = 0; f < frames; f++)
+        {
+            const float y = work_[f] + offset;
+            block.samples[f * channels + c] = y <= 0.f ? 0 : (y >= UINT16_MAX ? UINT16_MAX : (sample_t)(y + 0.5f));
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include "frame_stream.h"
+
+#include <string.h>
+
+#if __has_include(<esp32/rom/crc.h>)
+#include <esp32/rom/crc.h>
+#define FRAME_HAS_ROM_CRC 1
+#else
+#define FRAME_HAS_ROM_CRC 0
+#endif
+
+uint32_t FrameStream::crc32(uint32_t crc, const uint8_t* data, size_t len)
+{
+#if FRAME_HAS_ROM_CRC
+    // Table-driven version in ROM, same polynomial and conditioning as zlib
+    return crc32_le(crc, data, len);
+#else
+    // Reflected 0xEDB88320, one nibble at a time
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+#endif
+}
+
+size_t FrameStream::max_encoded_len(size_t samples_len)
+{
+    // One code byte per 254 data bytes, rounded up, and the delimiter
+    const size_t raw = HEADER_LEN + samples_len + CRC_LEN;
+    return raw + raw / 254 + 1 + 1;
+}
+
+int FrameStream::write_block(const SampleBlock& block)
+{
+    if (!enabled())
+    {
+        return -1;
+    }
+
+    // All or nothing: a frame cut short would cost the host the next one too
+    const uint16_t frames = block.frames();
+    const size_t samples_len = (size_t)frames * block.channels * sizeof(sample_t);
+    if (out_.available_for_write() < max_encoded_len(samples_len))
+    {
+        seq_++;
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return -1;
+    }
+
+    // Header in the layout documented in frame_stream.h, native little endian
+    const uint16_t reserved = 0;
+    uint8_t header[HEADER_LEN];
+    header[0] = FRAME_VERSION;
+    header[1] = block.channels;
+    header[2] = block.frac_bits;
+    header[3] = 0;
+    memcpy(&header[4], &seq_, 4);
+    memcpy(&header[8], &frames, 2);
+    memcpy(&header[10], &reserved, 2);
+    memcpy(&header[12], &block.t0_us, 8);
+    memcpy(&header[20], &block.period_ns, 4);
+
+    // The samples go out straight from the block
+    const uint8_t* samples = (const uint8_t*)block.samples;
+    uint32_t crc = crc32(0, header, HEADER_LEN);
+    crc = crc32(crc, samples, samples_len);
+
+    frame_bytes_ = 0;
+    put(header, HEADER_LEN);
+    put(samples, samples_len);
+    put((const uint8_t*)&crc, CRC_LEN);
+    end_frame();
+
+    seq_++;
+    frames_.store(frames_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    bytes_.store(bytes_.load(std::memory_order_relaxed) + frame_bytes_, std::memory_order_relaxed);
+    return 0;
+}
+
+// COBS: each group is a code byte n followed by n - 1 non-zero bytes, and stands for those bytes plus a
+// zero (dropped at the end of the frame). n = 0xFF is a full group of 254 bytes with no zero after it.
+void FrameStream::put(const uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (data[i] == 0)
+        {
+            flush_group();
+            continue;
+        }
+        group_[group_len_++] = data[i];
+        if (group_len_ == 0xFF)
+        {
+            flush_group();
+        }
+    }
+}
+
+void FrameStream::flush_group()
+{
+    group_[0] = group_len_;
+    out_.write(group_, group_len_);
+    frame_bytes_ += group_len_;
+    group_len_ = 1;
+}
+
+void FrameStream::end_frame()
+{
+    flush_group();
+    const uint8_t delimiter = 0;
+    out_.write(&delimiter, 1);
+    frame_bytes_ += 1;
+}
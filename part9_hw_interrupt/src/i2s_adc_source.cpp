@@ -0,0 +1,134 @@
+#include "i2s_adc_source.h"
+
+#include <driver/adc.h>
+#include <driver/i2s.h>
+#include <esp_timer.h>
+#include <xtensa/core-macros.h>
+
+static const i2s_port_t i2s_port = I2S_NUM_0; // only I2S0 can drive the built-in ADC
+static const uint32_t i2s_max_rate = 150000; // fastest rate the I2S-ADC path is specified for
+
+I2sAdcSource::I2sAdcSource(BaseType_t core)
+    : core_(core)
+{
+}
+
+bool I2sAdcSource::begin(SampleSink* sink, uint32_t rate_hz)
+{
+    // I2S can only sample ADC1 channels
+    int8_t channel = channels_ == 1 ? digitalPinToAnalogChannel(pins_[0]) : -1;
+    if (task_ != NULL || rate_hz == 0 || rate_hz > i2s_max_rate || channel < 0 || channel >= ADC1_CHANNEL_MAX)
+    {
+        return false;
+    }
+
+    i2s_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+    config.sample_rate = rate_hz;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = DMA_BUF_CNT;
+    config.dma_buf_len = DMA_BUF_LEN;
+
+    if (i2s_driver_install(i2s_port, &config, 0, NULL) != ESP_OK)
+    {
+        return false;
+    }
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten((adc1_channel_t)channel, ADC_ATTEN_DB_11);
+    i2s_set_adc_mode(ADC_UNIT_1, (adc1_channel_t)channel);
+
+    sink_ = sink;
+    rate_hz_ = rate_hz;
+    reset_cost();
+    stop_.store(false, std::memory_order_relaxed);
+    reading_.store(true, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(taskRead, "taskI2sAdc", 2048, this, 3, &task_, core_) != pdPASS)
+    {
+        task_ = NULL;
+        reading_.store(false, std::memory_order_relaxed);
+        i2s_driver_uninstall(i2s_port);
+        return false;
+    }
+    i2s_adc_enable(i2s_port);
+    return true;
+}
+
+void I2sAdcSource::end()
+{
+    if (task_ == NULL)
+    {
+        return;
+    }
+
+    // Deleting the reader from here could catch it inside i2s_read() with the driver's lock held, and the
+    // uninstall below would then wait for it forever. Ask it to stop and let it delete itself.
+    stop_.store(true, std::memory_order_relaxed);
+    while (reading_.load(std::memory_order_acquire))
+    {
+        vTaskDelay(1);
+    }
+    task_ = NULL;
+    i2s_adc_disable(i2s_port);
+    i2s_driver_uninstall(i2s_port);
+}
+
+bool I2sAdcSource::set_rate(uint32_t rate_hz)
+{
+    if (task_ == NULL || rate_hz == 0 || rate_hz > i2s_max_rate)
+    {
+        return false;
+    }
+
+    // Reprograms the I2S clock dividers, DMA buffers already queued are still delivered
+    if (i2s_set_sample_rates(i2s_port, rate_hz) != ESP_OK)
+    {
+        return false;
+    }
+    rate_hz_ = rate_hz;
+    reset_cost();
+    return true;
+}
+
+// Block on the DMA queue and forward every completed DMA buffer to the sink, until end() asks to stop
+void I2sAdcSource::taskRead(void* parameters)
+{
+    I2sAdcSource* self = (I2sAdcSource*)parameters;
+
+    while (!self->stop_.load(std::memory_order_relaxed))
+    {
+        // One DMA buffer per read, so a timeout returns before anything was copied
+        size_t bytes_read = 0;
+        i2s_read(i2s_port, self->dma_buf_, sizeof(self->dma_buf_), &bytes_read, READ_TIMEOUT_MS / portTICK_PERIOD_MS);
+        if (bytes_read == 0)
+        {
+            continue; // no buffer completed in time, check the flag again
+        }
+        uint32_t start = xthal_get_ccount();
+        uint64_t end_us = esp_timer_get_time();
+
+        // Each DMA word holds the channel number in the top 4 bits and the 12-bit conversion below it
+        size_t len = bytes_read / sizeof(sample_t);
+        for (size_t i = 0; i < len; i++)
+        {
+            self->dma_buf_[i] &= 0x0FFF;
+        }
+        // The DMA buffer completed right before i2s_read() returned, so the last sample was taken about now.
+        // The converter is clocked, earlier samples sit on the exact period grid before it.
+        uint32_t period_ns = 1000000000u / self->rate_hz_;
+        uint64_t span_us = len > 1 ? ((uint64_t)(len - 1) * period_ns) / 1000 : 0;
+        self->sink_->on_frames(self->dma_buf_, len, 1, end_us - span_us, period_ns);
+
+        if (len > 0)
+        {
+            self->record_cost(xthal_get_ccount() - start, len);
+        }
+    }
+
+    // Out of the driver for good, end() may uninstall it now
+    self->reading_.store(false, std::memory_order_release);
+    vTaskDelete(NULL);
+}
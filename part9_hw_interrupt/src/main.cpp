@@ -10,6 +10,26 @@ back to Serial. If the user types the command "avg", print out the average value
 */
 
 #include <Arduino.h>
+#include <esp_freertos_hooks.h>
+#include <esp_timer.h>
+#include <xtensa/core-macros.h>
+#include "acquisition.h"
+#include "aggregate_pyramid.h"
+#include "command_table.h"
+#include "filter_bank.h"
+#include "frame_stream.h"
+#include "i2s_adc_source.h"
+#include "isr_histogram.h"
+#include "moving_average.h"
+#include "quantile_sketch.h"
+#include "sampler_config.h"
+#include "serial_frame_output.h"
+#include "sim_source.h"
+#include "snapshot.h"
+#include "spectrum.h"
+#include "task_notifier.h"
+#include "timer_adc_source.h"
+#include "window_stats.h"
 
 // Use only core 1 for demo purposes
 #if CONFIG_FREERTOS_UNICORE
@@ -18,145 +38,917 @@ back to Serial. If the user types the command "avg", print out the average value
     static const BaseType_t app_cpu = 1;
 #endif
 
-typedef struct
-{
-    uint32_t* const arr; // pointer is constant, but buffer is not
-    int head; // pointer to head of circular buff
-    int tail; // pointer to tail of circular buff
-    const int max_len;
-} circ_bbuf_t;
-
-// macro for declaring and initializing circ_bbuf_t objects
-#define CIRC_BBUF_DEF(x,y)                \
-    uint32_t x##_data_space[y];            \
-    static volatile circ_bbuf_t x = {                     \
-        .arr = x##_data_space,         \
-        .head = 0,                        \
-        .tail = 0,                        \
-        .max_len = y                       \
-    }
-
 // Settings
-static const uint16_t timer_div = 80; // prescaler
-static const uint64_t timer_max_count = 100000; // approximately .1s to achieve 10Hz
-static const uint8_t CMD_BUF_LEN = 255; // message queue length
-static const uint8_t BUF_LEN = 10; // # length of ISR fifo sample buffer
-static const char avg_cmd[] = "avg";
+#if defined(SAMPLE_SOURCE_I2S)
+static const uint32_t sample_rate_hz = 20000; // I2S-ADC cannot run at low rates
+#else
+static const uint32_t sample_rate_hz = 10; // 10 samples per 1s window
+#endif
+static const uint16_t CMD_BUF_LEN = 1024; // longest command line: filter fir with 64 taps of up to 13 chars each
+static const uint16_t STREAM_TX_BUF_LEN = 4096; // UART TX buffer, a full-size stream frame (~2KB) fits while one drains
+static const uint8_t CLI_MAX_ARGS = FilterBank::FIR_MAX_TAPS + 2; // longest command line: filter fir <taps>
+#if defined(STATS_METRICS)
+static const uint8_t stats_metrics = STATS_METRICS; // STAT_* mask chosen at build time
+#else
+static const uint8_t stats_metrics = STAT_ALL;
+#endif
+#if defined(QUANTILE_SUB_BITS)
+static const uint8_t quantile_sub_bits = QUANTILE_SUB_BITS; // percentile resolution / RAM trade-off
+#else
+static const uint8_t quantile_sub_bits = 7; // within 1/128 of the true percentile, 2.8KB per channel
+#endif
+#if defined(AVG_FIXED_POINT)
+static const uint16_t fft_boot_size = 0; // FFT off so the task stays integer-only, "fft <size>" turns it on
+#else
+static const uint16_t fft_boot_size = 1024; // FFT points at boot
+#endif
+static const size_t AVG_HISTORY_LEN = 16384; // samples of moving average history, all channels (32KB)
 
 // Pins
-static const int adc_pin = A0; // adc0
+static const int adc_pins[] = {A0}; // adc pins scanned per tick at boot, up to SAMPLE_MAX_CHANNELS
+
+// Sample source, selected at build time (see platformio.ini)
+#if defined(SAMPLE_SOURCE_I2S)
+static I2sAdcSource source(app_cpu); // continuous DMA sampling, no per-sample interrupt
+#elif defined(SAMPLE_SOURCE_SIM)
+static SimulatedSource source(SimWaveform{2048.f, 1000.f, 1.f, 50.f}); // 1Hz sine, no board needed
+#else
+static TimerAdcSource source(0 /*timer id*/); // hw timer ISR + analogRead
+#endif
+
+// Everything taskCalculateAverage computes per window, published as one consistent snapshot
+struct Results
+{
+#if defined(AVG_FIXED_POINT)
+    uq16_16_t avg[SAMPLE_MAX_CHANNELS]; // per-channel moving average
+    uq16_16_t avg_offset; // included in avg, see filter_bank.h
+#else
+    float avg[SAMPLE_MAX_CHANNELS]; // per-channel moving average
+#endif
+    uint8_t channels; // # of valid channel entries
+    uint8_t sketch_frac_bits; // fraction bits of the values in the quantile sketches
+    sample_t sketch_offset; // filter offset included in the sketched values
+    ChannelStats stats[SAMPLE_MAX_CHANNELS]; // stats of the last window
+    uint32_t latency_us; // sample-to-result latency of the last window (last frame timestamp to now)
+    uint32_t latency_max_us; // worst latency seen so far
+    uint32_t wakeups; // notifications taken by the task
+    uint32_t blocks; // blocks processed, blocks / wakeups > 1 means the task caught up on a backlog
+    Aggregate aggregates[AggregatePyramid::LEVELS][SAMPLE_MAX_CHANNELS]; // last completed 1 s / 1 min / 1 h
+    uint32_t agg_offset; // filter offset included in the aggregates
+    SpectralPeak peaks[SpectrumAnalyzer::MAX_PEAKS]; // of the last FFT, largest first
+    uint8_t peak_count;
+    uint32_t fft_count;
+    float bin_hz;
+};
 
 // Globals
-CIRC_BBUF_DEF(my_circ_buf, BUF_LEN); // circular buffer for storing samples from ADC
-static uint8_t buf_idx = 0; // keeps track of the circular buffers idx
-static float avg = 0.; // stores the avg value of the last 10 samples
-static hw_timer_t* timer = NULL; // hw timer to sample from ADC at 10hz
+static Acquisition acquisition; // packs samples into blocks for taskCalculateAverage
+static SamplerConfig sampler_config(source, acquisition); // runtime rate/window changes from the CLI
+static FilterBank filter_bank; // FIR + biquads applied to every block before the statistics
+static SpectrumAnalyzer spectrum(fft_boot_size); // windowed FFT over consecutive blocks, ~44KB arena
+static AggregatePyramid pyramid; // 1 s -> 1 min -> 1 h aggregates
+static SerialFrameOutput stream_output(Serial);
+static FrameStream stream(stream_output); // binary export of the raw blocks, shares the UART with the CLI
+static MovingAverage<AVG_HISTORY_LEN> moving_avg(DEFAULT_WINDOW_LEN); // sliding window, owned by taskCalculateAverage
+static Snapshot<Results> results; // written by taskCalculateAverage, read by the CLI without locks
+static Results cli_res; // copy of the results the CLI commands print from, too big for the task stack
+static QuantileSketch<quantile_sub_bits> sketches[SAMPLE_MAX_CHANNELS]; // percentiles since boot/reset, per channel
+static uint8_t sketch_channels = 0; // layout the sketches were filled with
+static uint8_t sketch_frac_bits = 0;
+static sample_t sketch_offset = 0;
+static IsrHistogram<7, 64> event_latency; // detection to handler wake-up, in CPU cycles
+static IsrHistogram<6, 256> event_age; // sample to handler wake-up, in us, past 16 ms goes in the last bucket
 static TaskHandle_t taskHandleCalculateAverage = NULL; // process task handle for calculating average
+static TaskHandle_t taskHandleEvents = NULL; // event handler task, highest priority
+static TaskHandle_t taskHandleCLI = NULL; // woken by the UART driver when bytes arrive
+static TaskNotifier average_notifier; // acquisition -> taskCalculateAverage, published block bits
+static TaskNotifier event_notifier; // event detector -> taskEventHandler
+static volatile uint32_t idle_loops = 0; // idle hook calls on app_cpu, see idle_hook()
+static uint32_t idle_loops_per_s = 0; // rate of idle_loops with app_cpu unloaded, measured in setup()
+
+// Feed every sample of block into its channel's quantile sketch. Starts over if the layout changed,
+// values with different channel order, fraction bits or filter offset cannot be ranked together.
+void feed_sketches(const SampleBlock& block)
+{
+    if (block.channels != sketch_channels || block.frac_bits != sketch_frac_bits ||
+        block.offset != sketch_offset)
+    {
+        for (uint8_t c = 0; c < SAMPLE_MAX_CHANNELS; c++)
+        {
+            sketches[c].reset();
+        }
+        sketch_channels = block.channels;
+        sketch_frac_bits = block.frac_bits;
+        sketch_offset = block.offset;
+    }
+
+    for (uint16_t i = 0; i < block.len; i += block.channels)
+    {
+        for (uint8_t c = 0; c < block.channels; c++)
+        {
+            sketches[c].add(block.samples[i + c]);
+        }
+    }
+}
+
+// Tasks
+// Wait for notification (from the acquisition stage) and calculate average of values from buffer
+// Task drains every ready block per notification and slides the moving average over them
+void taskCalculateAverage(void* parameters)
+{
+    static Results out = {}; // working copy, too big for the task stack
+
+    while (1)
+    {
+        // Similar to xSempahoreTake() but uses a notification (faster) in place of a semaphore.
+        // The value holds a bit per published block; clear it all, the queue itself says what is ready.
+        uint32_t published;
+        xTaskNotifyWait(0, UINT32_MAX, &published, portMAX_DELAY);
+        out.wakeups++;
+
+        // Drain everything that is ready, however many blocks the notification covered
+        uint64_t last_frame_us = 0;
+        bool processed = false;
+        while (acquisition.ready_count() > 0)
+        {
+            // The block is stable while we hold it, work on it in place and give it back to the source
+            SampleBlock* block = acquisition.acquire();
+            if (block == NULL)
+            {
+                break; // the source reclaimed the block (OverwriteOldest), counted as an underrun
+            }
+            // Export the raw samples before the filter overwrites them. Dropped if the UART cannot take the
+            // frame right now, the task never waits for the line.
+            stream.write_block(*block);
+            // Filter in place first, everything below sees the filtered samples
+            filter_bank.process(*block);
+            // O(1) per frame whatever the span, the window sums are exact integers
+            moving_avg.push_block(*block);
+            // Second read of the block (now in cache) for the per-window statistics
+            window_stats<stats_metrics>(*block, out.stats);
+            feed_sketches(*block);
+            spectrum.push_block(*block);
+            pyramid.push_block(*block);
+            last_frame_us = block->timestamp_us(block->frames() - 1);
+            acquisition.release(block);
+            out.blocks++;
+            processed = true;
+        }
+        if (!processed)
+        {
+            continue;
+        }
+
+        // Assemble the results privately, readers only ever see complete snapshots
+        out.channels = moving_avg.channels();
+        for (uint8_t c = 0; c < out.channels; c++)
+        {
+#if defined(AVG_FIXED_POINT)
+            // Integer only. With the filter and the FFT off (as at boot) the task never uses the FPU.
+            out.avg[c] = moving_avg.mean_fixed<16>(c);
+            out.avg_offset = moving_avg.offset_fixed<16>();
+#else
+            out.avg[c] = moving_avg.mean(c);
+#endif
+        }
+        out.sketch_frac_bits = sketch_frac_bits;
+        out.sketch_offset = sketch_offset;
+        out.agg_offset = pyramid.offset();
+        for (uint8_t level = 0; level < AggregatePyramid::LEVELS; level++)
+        {
+            for (uint8_t c = 0; c < out.channels; c++)
+            {
+                out.aggregates[level][c] = pyramid.last(level, c);
+            }
+        }
+        out.peak_count = spectrum.peak_count();
+        for (uint8_t i = 0; i < out.peak_count; i++)
+        {
+            out.peaks[i] = spectrum.peak(i);
+        }
+        out.fft_count = spectrum.frame_count();
+        out.bin_hz = spectrum.bin_hz();
+
+        // The frames carry hardware timestamps, so the delay through the buffers is measured, not assumed.
+        // Only meaningful for real sources, the simulated one runs on a virtual clock.
+        out.latency_us = (uint32_t)(esp_timer_get_time() - last_frame_us);
+        if (out.latency_us > out.latency_max_us)
+        {
+            out.latency_max_us = out.latency_us;
+        }
+
+        results.publish(out);
+    }
+}
+
+// Woken by the event detector as soon as a sample crosses a rule, well ahead of the window average.
+// Two latencies are kept: detector to handler (cycles), and sample to handler (us, what an alarm sees).
+// With the I2S source the second one includes the wait for a full DMA buffer, 12.8 ms at 20 kHz.
+void taskEventHandler(void* parameters)
+{
+    static const char* kind_names[] = {"rising", "falling", "slope"};
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        DetectorEvent event;
+        while (acquisition.detector().pop(&event) == 0)
+        {
+            // Detector and handler run on the same core, so their cycle counters compare
+            uint32_t cycles = xthal_get_ccount() - event.ccount;
+            event_latency.record(cycles);
+            // Same hardware clock as the frame timestamps (virtual for the simulated source)
+            uint32_t age_us = (uint32_t)(esp_timer_get_time() - event.timestamp_us);
+            event_age.record(age_us);
+
+            // Alarm action goes here, after the latency is taken
+            Serial.printf("event: ch%u %s %u at %llu us, %u cycles to handler, %u us since the sample\r\n",
+                (unsigned)event.channel, kind_names[(uint8_t)event.kind], (unsigned)event.value,
+                (unsigned long long)event.timestamp_us, (unsigned)cycles, (unsigned)age_us);
+        }
+    }
+}
+
+#if defined(SAMPLE_SOURCE_SIM)
+// Feed the simulated source in real time, 1/10 of a second worth of samples per tick
+void taskSimulate(void* parameters)
+{
+    while (1)
+    {
+        source.pump(source.rate() / 10);
+        vTaskDelay(100 / portTICK_PERIOD_MS);
+    }
+}
+#endif
+
+// Print the non-empty buckets of one histogram, of cycle counts (also shown in nanoseconds) or microseconds
+template <typename Histogram>
+void print_histogram(const char* label, const Histogram& hist, bool cycles = true)
+{
+    uint32_t min = hist.count() ? hist.min() : 0;
+    if (cycles)
+    {
+        uint32_t cpu_mhz = getCpuFrequencyMhz();
+        Serial.printf("%s: %u samples, min %u max %u cycles (%u..%u ns)\r\n", label, (unsigned)hist.count(),
+            (unsigned)min, (unsigned)hist.max(), (unsigned)(min * 1000 / cpu_mhz),
+            (unsigned)(hist.max() * 1000 / cpu_mhz));
+    }
+    else
+    {
+        Serial.printf("%s: %u samples, min %u max %u us\r\n", label, (unsigned)hist.count(), (unsigned)min,
+            (unsigned)hist.max());
+    }
+    for (size_t i = 0; i < Histogram::BUCKET_CNT; i++)
+    {
+        uint32_t n = hist.bucket(i);
+        if (n == 0)
+        {
+            continue;
+        }
+        uint32_t lo = i * Histogram::BUCKET_WIDTH;
+        if (i + 1 < Histogram::BUCKET_CNT)
+        {
+            Serial.printf("  %6u..%6u: %u\r\n", (unsigned)lo, (unsigned)(lo + Histogram::BUCKET_WIDTH - 1), (unsigned)n);
+        }
+        else
+        {
+            Serial.printf("  %6u..      : %u\r\n", (unsigned)lo, (unsigned)n);
+        }
+    }
+}
 
-// func for pushing byte into buffer
-int circ_bbuf_push(volatile circ_bbuf_t* buf, uint32_t data)
+// Time both filter backends on the staged config over one synthetic block and compare their outputs.
+// The block is shorter than a full window to keep the buffers small; the cost per sample is the same.
+void filter_bench()
 {
-    // queue is full    
-    if (buf->tail == buf->head)
+    static const uint16_t len = 128;
+    static float output[2][len]; // static, too big for the CLI task stack
+
+    float fir_rev[FilterBank::FIR_MAX_TAPS];
+    const uint8_t taps = filter_bank.fir_taps();
+    for (uint8_t k = 0; k < taps; k++)
+    {
+        fir_rev[k] = filter_bank.fir_tap(taps - 1 - k);
+    }
+
+    const FilterBank::Backend backends[] = {FilterBank::Backend::Portable, FilterBank::Backend::EspDsp};
+    const char* names[] = {"portable", "esp-dsp"};
+    const uint8_t backend_cnt = FilterBank::has_esp_dsp() ? 2 : 1;
+    for (uint8_t b = 0; b < backend_cnt; b++)
+    {
+        float history[FilterBank::FIR_MAX_TAPS - 1] = {};
+        float w[FilterBank::BIQUAD_MAX_STAGES][2] = {};
+        for (uint16_t i = 0; i < len; i++)
+        {
+            output[b][i] = 2048.f + 1000.f * sinf(i * 0.05f) + (float)(i * 7919 % 101) - 50.f; // sine + pseudo noise
+        }
+
+        uint32_t start = xthal_get_ccount();
+        if (taps > 0)
+        {
+            FilterBank::fir(backends[b], fir_rev, taps, history, output[b], len);
+        }
+        for (uint8_t s = 0; s < filter_bank.biquad_stages(); s++)
+        {
+            FilterBank::biquad(backends[b], filter_bank.biquad_coefs(s), w[s], output[b], len);
+        }
+        uint32_t cycles = xthal_get_ccount() - start;
+
+        Serial.printf("%s: %u cycles/%u samples, %u samples/s\r\n", names[b], (unsigned)cycles, (unsigned)len,
+            (unsigned)((uint64_t)len * getCpuFrequencyMhz() * 1000000 / (cycles ? cycles : 1)));
+    }
+
+    if (backend_cnt == 2)
     {
-        return -1;
+        float max_diff = 0.f;
+        for (uint16_t i = 0; i < len; i++)
+        {
+            max_diff = fmaxf(max_diff, fabsf(output[0][i] - output[1][i]));
+        }
+        Serial.printf("max difference between backends: %g\r\n", max_diff);
     }
+}
 
-    buf->arr[buf->head] = data; // save data to head
-    // increment head and check if buffer is full
-    buf->head = (buf->head + 1) % buf->max_len;
-    return 0;
+// Numeric argument i, 0 if absent. The dispatcher has checked it against the command's <u> pattern.
+uint32_t arg_uint(uint8_t argc, char** argv, uint8_t i)
+{
+    return i < argc ? strtoul(argv[i], NULL, 10) : 0;
+}
+
+// True if argument i is present and equals word
+bool arg_is(uint8_t argc, char** argv, uint8_t i, const char* word)
+{
+    return i < argc && strcmp(argv[i], word) == 0;
+}
+
+// "agg": print the last completed window of every level
+void cli_agg(uint8_t argc, char** argv)
+{
+    static const char* level_names[AggregatePyramid::LEVELS] = {"1s", "1min", "1h"};
+    const float scale = 1.f / (1u << AggregatePyramid::FRAC_BITS);
+    for (uint8_t level = 0; level < AggregatePyramid::LEVELS; level++)
+    {
+        for (uint8_t ch = 0; ch < cli_res.channels; ch++)
+        {
+            const Aggregate& a = cli_res.aggregates[level][ch];
+            if (a.count == 0)
+            {
+                Serial.printf("%s ch%u: not complete yet\r\n", level_names[level], (unsigned)ch);
+                continue;
+            }
+            const float offset = cli_res.agg_offset;
+            Serial.printf("%s ch%u: n=%u mean=%.2f min=%.2f max=%.2f\r\n", level_names[level],
+                (unsigned)ch, (unsigned)a.count, ((float)a.sum / a.count - offset) * scale,
+                (a.min - offset) * scale, (a.max - offset) * scale);
+        }
+    }
 }
 
-// Retrieve value from shared buffer via data. Success if return value is 0.
-int circ_bbuf_pop(volatile circ_bbuf_t* buf, uint32_t* data)
+// Time one window mean as the float path computes it against the fixed-point path, on this task
+void avg_bench()
 {
-    // buffer is empty
-    if (buf->tail == buf->head)
+    static const uint8_t MEANS = 64;
+    static const uint32_t n = 1000; // frames per window, not a power of two
+    uint32_t sums[MEANS];
+    float mean_f[MEANS];
+    uint32_t mean_q[MEANS];
+    for (uint8_t i = 0; i < MEANS; i++)
+    {
+        sums[i] = (uint32_t)(((uint64_t)i * 2654435761u) % (4096u * n)); // spread over the 12-bit range
+    }
+
+    uint32_t start = xthal_get_ccount();
+    for (uint8_t i = 0; i < MEANS; i++)
     {
-        return -1;
+        mean_f[i] = sums[i] / (float)n;
     }
+    const uint32_t float_cycles = xthal_get_ccount() - start;
+
+    start = xthal_get_ccount();
+    const Reciprocal r = reciprocal(n);
+    const uint32_t recip_cycles = xthal_get_ccount() - start;
 
-    // copy value from buffer to data and return 0 for success
-    *data = buf->arr[buf->tail];
-    buf->tail = (buf->tail + 1) % buf->max_len;
-    return 0;
+    start = xthal_get_ccount();
+    for (uint8_t i = 0; i < MEANS; i++)
+    {
+        mean_q[i] = fixed_mean<16>(sums[i], r, 0);
+    }
+    const uint32_t fixed_cycles = xthal_get_ccount() - start;
+
+    float max_diff = 0.f;
+    for (uint8_t i = 0; i < MEANS; i++)
+    {
+        max_diff = fmaxf(max_diff, fabsf(mean_f[i] - mean_q[i] / 65536.f));
+    }
+    Serial.printf("float: %u cycles/mean\r\n", (unsigned)(float_cycles / MEANS));
+    Serial.printf("fixed: %u cycles/mean, %u cycles per window length change\r\n",
+        (unsigned)(fixed_cycles / MEANS), (unsigned)recip_cycles);
+    Serial.printf("max difference: %g ADC counts\r\n", max_diff);
 }
 
-// Interrupt Service Routines
-// IRAM_ATTR = specify that the function is loaded into internal ram instead of flash
-// Sample from adc and add to buffer
-void IRAM_ATTR onTimer()
+// "avg [bench]": print the moving average per channel, or time the float and fixed-point means
+void cli_avg(uint8_t argc, char** argv)
 {
-    // buf_idx = 0; // idx to keep track of current buffer fill
-    BaseType_t task_woken = pdFALSE; // Keeps track of the task status
+    if (arg_is(argc, argv, 1, "bench"))
+    {
+        avg_bench();
+        return;
+    }
 
-    // Only read adc and push to buffer if under the buffer length
-    if (buf_idx < BUF_LEN)
+    for (uint8_t ch = 0; ch < cli_res.channels; ch++)
     {
-        uint16_t val = analogRead(adc_pin);
-        if (circ_bbuf_push(&my_circ_buf, val) == 0)
+#if defined(AVG_FIXED_POINT)
+        // Unsigned, so the filter offset is taken off the magnitude and the sign printed separately
+        const bool negative = cli_res.avg[ch] < cli_res.avg_offset;
+        const uq16_16_t magnitude =
+            negative ? cli_res.avg_offset - cli_res.avg[ch] : cli_res.avg[ch] - cli_res.avg_offset;
+        uint32_t int_part, decimals;
+        q16_16_parts(magnitude, 2, &int_part, &decimals);
+        Serial.printf("%s%u.%02u%s", negative ? "-" : "", (unsigned)int_part, (unsigned)decimals,
+            ch + 1 < cli_res.channels ? " " : "\r\n");
+#else
+        if (ch + 1 < cli_res.channels)
         {
-            buf_idx++;   
+            Serial.print(cli_res.avg[ch]);
+            Serial.print(' ');
         }
+        else
+        {
+            Serial.println(cli_res.avg[ch]);
+        }
+#endif
     }
+}
 
-    // After 10 items have been added to the buffer, notify task to calculate average
-    if (buf_idx >= BUF_LEN)
+// Restart the source with a new pin list, keeping the current rate.
+// Falls back to the previous pins if the new list is rejected. Returns 0 on success, -1 otherwise.
+int set_channels(const int* pins, uint8_t count)
+{
+    int old_pins[SAMPLE_MAX_CHANNELS];
+    uint8_t old_count = source.channels();
+    for (uint8_t ch = 0; ch < old_count; ch++)
     {
-        // idx = 0; // Reset counter
-        vTaskNotifyGiveFromISR(taskHandleCalculateAverage, &task_woken);
+        old_pins[ch] = source.pin(ch);
     }
 
-    // Use task_woken to check if the taskCalculateAverage is awoken from the semaphore / notification
-    // and if so, immediately context switch to the task via portYIELD_FROM_ISR()
-    if (task_woken)
+    uint32_t rate_hz = source.rate();
+    source.end();
+    if (source.set_pins(pins, count) && source.begin(&acquisition, rate_hz))
     {
-        portYIELD_FROM_ISR();
+        return 0;
     }
 
-    // Allow scheduler to choose next task
+    source.set_pins(old_pins, old_count);
+    source.begin(&acquisition, rate_hz);
+    return -1;
 }
 
-// Tasks
-// Wait for semaphore (from ISR) and calculate average of values from buffer
-// Task reads 10 values from the circular buffer before updating index
-void taskCalculateAverage(void* parameters)
+// "channels [pin ...]": print or change the scanned pins
+void cli_channels(uint8_t argc, char** argv)
 {
-    while (1)
+    int pins[SAMPLE_MAX_CHANNELS];
+    uint8_t count = 0;
+    for (uint8_t i = 1; i < argc && count < SAMPLE_MAX_CHANNELS; i++)
     {
-        // Similar to xSempahoreTake() but uses a notification (faster) in place of a semaphore
-        // xClearCountOnExit = when set to true will reset the notification counter to 0
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        pins[count++] = strtol(argv[i], NULL, 10);
+    }
+    if (argc - 1 > SAMPLE_MAX_CHANNELS || (count > 0 && set_channels(pins, count) != 0))
+    {
+        Serial.printf("Rejected %u pins (%s source scans up to %u)\r\n",
+            (unsigned)(argc - 1), source.name(), (unsigned)source.max_channels());
+    }
+    Serial.print("Pins:");
+    for (uint8_t ch = 0; ch < source.channels(); ch++)
+    {
+        Serial.printf(" %d", source.pin(ch));
+    }
+    Serial.println();
+}
+
+// Idle hook of app_cpu. Returning false keeps the idle task looping instead of waiting for an interrupt,
+// so the loop count is proportional to the time nothing else ran. Works with the stock sdkconfig, unlike
+// the FreeRTOS run-time stats.
+bool idle_hook()
+{
+    idle_loops++;
+    return false;
+}
+
+// "cpu": idle share of app_cpu over the next second: idle loops counted against the rate of the unloaded
+// core measured at boot. The CLI itself sleeps meanwhile, as it does between commands.
+void cli_cpu(uint8_t argc, char** argv)
+{
+    if (idle_loops_per_s == 0)
+    {
+        Serial.println("No idle calibration (idle hook not registered)");
+        return;
+    }
+
+    const uint32_t loops = idle_loops;
+    const int64_t start_us = esp_timer_get_time();
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    const uint32_t d_loops = idle_loops - loops;
+    const uint32_t d_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    uint64_t permille = (uint64_t)d_loops * 1000000000u / ((uint64_t)idle_loops_per_s * d_us);
+    permille = permille > 1000 ? 1000 : permille; // the calibration second had its own tick interrupts
+    Serial.printf("cpu%u idle: %u.%u%% over %u ms\r\n", (unsigned)app_cpu, (unsigned)(permille / 10),
+        (unsigned)(permille % 10), (unsigned)(d_us / 1000));
+}
+
+// "event [reset | <ch> off | <ch> <high> <low> [max step]]": print or change the detector rules
+void cli_event(uint8_t argc, char** argv)
+{
+    EventDetector& detector = acquisition.detector();
+    if (arg_is(argc, argv, 1, "reset"))
+    {
+        event_latency.reset();
+        event_age.reset();
+        Serial.println("Event latency cleared");
+    }
+    else if (argc > 1)
+    {
+        uint32_t channel = arg_uint(argc, argv, 1);
+        EventDetector::Rule rule = {0, 0, 0};
+        if (!arg_is(argc, argv, 2, "off"))
+        {
+            uint32_t high = arg_uint(argc, argv, 2);
+            uint32_t low = arg_uint(argc, argv, 3);
+            uint32_t max_step = arg_uint(argc, argv, 4);
+            rule.high = high > UINT16_MAX ? UINT16_MAX : high;
+            rule.low = low > UINT16_MAX ? UINT16_MAX : low;
+            rule.max_step = max_step > UINT16_MAX ? UINT16_MAX : max_step;
+        }
+        if (channel > UINT8_MAX || detector.set_rule(channel, rule) != 0)
+        {
+            Serial.printf("Rejected (channel < %u, low < high or high 0 for no levels)\r\n", (unsigned)SAMPLE_MAX_CHANNELS);
+        }
+    }
+
+    for (uint8_t ch = 0; ch < source.channels(); ch++)
+    {
+        EventDetector::Rule rule = detector.rule(ch);
+        Serial.printf("ch%u: ", (unsigned)ch);
+        if (rule.high != 0)
+        {
+            Serial.printf("high %u low %u ", (unsigned)rule.high, (unsigned)rule.low);
+        }
+        if (rule.max_step != 0)
+        {
+            Serial.printf("max step %u ", (unsigned)rule.max_step);
+        }
+        Serial.println(rule.high == 0 && rule.max_step == 0 ? "off" : "");
+    }
+    Serial.printf("dropped: %u\r\n", (unsigned)detector.dropped());
+    print_histogram("handler latency", event_latency);
+    print_histogram("sample to handler", event_age, false);
+}
+
+// "fft [peaks [k] | <size> [hann|hamming] [channel]]": print peaks or change the FFT stage, size 0 turns it off
+void cli_fft(uint8_t argc, char** argv)
+{
+    if (arg_is(argc, argv, 1, "peaks"))
+    {
+        uint32_t k = argc > 2 ? arg_uint(argc, argv, 2) : SpectrumAnalyzer::MAX_PEAKS;
+        uint8_t count = cli_res.peak_count < k ? cli_res.peak_count : k;
+        Serial.printf("%u FFTs, %.3f Hz/bin\r\n", (unsigned)cli_res.fft_count, cli_res.bin_hz);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            Serial.printf("  %.2f Hz: %.2f\r\n", cli_res.peaks[i].freq_hz, cli_res.peaks[i].magnitude);
+        }
+        return;
+    }
+
+    if (argc > 1)
+    {
+        uint32_t size = arg_uint(argc, argv, 1);
+        FftWindow window = spectrum.window();
+        uint32_t channel = spectrum.channel();
+        for (uint8_t i = 2; i < argc; i++)
+        {
+            if (strcmp(argv[i], "hann") == 0)
+            {
+                window = FftWindow::Hann;
+            }
+            else if (strcmp(argv[i], "hamming") == 0)
+            {
+                window = FftWindow::Hamming;
+            }
+            else
+            {
+                channel = strtoul(argv[i], NULL, 10);
+            }
+        }
+        if (size > UINT16_MAX || channel > UINT8_MAX || spectrum.set_config(size, window, channel) != 0)
+        {
+            Serial.printf("Rejected (size: 0 for off or a power of two %u..%u, channel < %u)\r\n",
+                (unsigned)SpectrumAnalyzer::MIN_SIZE, (unsigned)SpectrumAnalyzer::MAX_SIZE, (unsigned)SAMPLE_MAX_CHANNELS);
+        }
+    }
+    if (spectrum.size() == 0)
+    {
+        Serial.println("FFT: off");
+        return;
+    }
+    Serial.printf("FFT: %u points, %s window, channel %u\r\n", (unsigned)spectrum.size(),
+        spectrum.window() == FftWindow::Hann ? "hann" : "hamming", (unsigned)spectrum.channel());
+}
+
+// "filter [fir|biquad <coefs> | off | backend portable|esp-dsp | bench]": print or change the filter stage
+void cli_filter(uint8_t argc, char** argv)
+{
+    int result = 0;
+
+    if (arg_is(argc, argv, 1, "fir") || arg_is(argc, argv, 1, "biquad"))
+    {
+        float coefs[FilterBank::FIR_MAX_TAPS];
+        uint8_t count = 0;
+        for (uint8_t i = 2; i < argc && count < FilterBank::FIR_MAX_TAPS; i++)
+        {
+            coefs[count++] = strtof(argv[i], NULL);
+        }
+        if (argc - 2 > FilterBank::FIR_MAX_TAPS)
+        {
+            result = -1; // more coefficients than fit, not silently cut short
+        }
+        else if (argv[1][0] == 'f')
+        {
+            result = filter_bank.set_fir(coefs, count);
+        }
+        else
+        {
+            result = count % FilterBank::BIQUAD_COEFS != 0 ? -1 :
+                filter_bank.set_biquads(coefs, count / FilterBank::BIQUAD_COEFS);
+        }
+    }
+    else if (arg_is(argc, argv, 1, "off"))
+    {
+        result = filter_bank.clear();
+    }
+    else if (arg_is(argc, argv, 1, "backend"))
+    {
+        if (arg_is(argc, argv, 2, "portable"))
+        {
+            result = filter_bank.set_backend(FilterBank::Backend::Portable);
+        }
+        else if (arg_is(argc, argv, 2, "esp-dsp"))
+        {
+            result = filter_bank.set_backend(FilterBank::Backend::EspDsp);
+        }
+        else
+        {
+            result = -1; // unknown backend name
+        }
+    }
+    else if (arg_is(argc, argv, 1, "bench"))
+    {
+        filter_bench();
+        return;
+    }
+
+    if (result != 0)
+    {
+        Serial.printf("Rejected (up to %u FIR taps, %u biquads of 5 coefs, backend portable or esp-dsp, "
+            "one change per block)\r\n",
+            (unsigned)FilterBank::FIR_MAX_TAPS, (unsigned)FilterBank::BIQUAD_MAX_STAGES);
+    }
+    Serial.printf("Backend: %s, FIR:", filter_bank.backend() == FilterBank::Backend::EspDsp ? "esp-dsp" : "portable");
+    for (uint8_t k = 0; k < filter_bank.fir_taps(); k++)
+    {
+        Serial.printf(" %g", filter_bank.fir_tap(k));
+    }
+    Serial.print(", biquads:");
+    for (uint8_t s = 0; s < filter_bank.biquad_stages(); s++)
+    {
+        const float* c = filter_bank.biquad_coefs(s);
+        Serial.printf(" [%g %g %g %g %g]", c[0], c[1], c[2], c[3], c[4]);
+    }
+    Serial.println(filter_bank.offsets_output() ? " (blocks DC, output offset to mid-scale)" : "");
+}
+
+void cli_help(uint8_t argc, char** argv);
+
+// "isr [reset]": print or reset the ISR timing histograms
+void cli_isr(uint8_t argc, char** argv)
+{
+#if !defined(SAMPLE_SOURCE_I2S) && !defined(SAMPLE_SOURCE_SIM)
+    if (arg_is(argc, argv, 1, "reset"))
+    {
+        source.reset_timing();
+        Serial.println("ISR histograms cleared");
+    }
+    else
+    {
+        print_histogram("latency", source.timing().latency);
+        print_histogram("exec", source.timing().exec);
+        print_histogram("jitter", source.timing().jitter);
+    }
+#else
+    Serial.printf("No ISR timing for the %s source\r\n", source.name());
+#endif
+}
+
+// "metrics": print the statistics of the last window per channel
+void cli_metrics(uint8_t argc, char** argv)
+{
+    for (uint8_t ch = 0; ch < cli_res.channels; ch++)
+    {
+        const ChannelStats& s = cli_res.stats[ch];
+        Serial.printf("ch%u n=%u", (unsigned)ch, (unsigned)s.count);
+        if (stats_metrics & STAT_MIN)
+        {
+            Serial.printf(" min=%.2f", s.min_counts());
+        }
+        if (stats_metrics & STAT_MAX)
+        {
+            Serial.printf(" max=%.2f", s.max_counts());
+        }
+        if (stats_metrics & STAT_MEAN)
+        {
+            Serial.printf(" mean=%.2f", s.mean());
+        }
+        if (stats_metrics & STAT_VARIANCE)
+        {
+            Serial.printf(" var=%.2f std=%.2f", s.variance(), s.stddev());
+        }
+        if (stats_metrics & STAT_RMS)
+        {
+            Serial.printf(" rms=%.2f", s.rms());
+        }
+        Serial.println();
+    }
+}
+
+// "oversample [ratio [order]]": print or change the oversampling ratio and CIC order
+void cli_oversample(uint8_t argc, char** argv)
+{
+    uint32_t ratio = arg_uint(argc, argv, 1);
+    uint32_t order = arg_uint(argc, argv, 2);
+    if (ratio != 0 && (ratio > UINT16_MAX || order > UINT8_MAX ||
+        sampler_config.set_oversampling(ratio, order == 0 ? 3 : order) != 0))
+    {
+        Serial.printf("Rejected oversampling x%u (power of two, order 1..%u, within the CPU budget)\r\n",
+            (unsigned)ratio, (unsigned)CicDecimator::MAX_ORDER);
+    }
+    Serial.printf("Oversampling: x%u, CIC order %u, source at %u Hz\r\n",
+        (unsigned)sampler_config.oversampling_ratio(), (unsigned)sampler_config.oversampling_order(),
+        (unsigned)source.rate());
+}
+
+// "quantiles [reset]": print or reset the per-channel percentiles
+void cli_quantiles(uint8_t argc, char** argv)
+{
+    if (arg_is(argc, argv, 1, "reset"))
+    {
+        for (uint8_t ch = 0; ch < SAMPLE_MAX_CHANNELS; ch++)
+        {
+            sketches[ch].reset();
+        }
+        Serial.println("Quantiles cleared");
+        return;
+    }
+
+    float scale = 1.f / (1u << cli_res.sketch_frac_bits);
+    const float offset = cli_res.sketch_offset;
+    for (uint8_t ch = 0; ch < cli_res.channels; ch++)
+    {
+        Serial.printf("ch%u n=%u p50=%.2f p90=%.2f p99=%.2f\r\n", (unsigned)ch,
+            (unsigned)sketches[ch].total(), (sketches[ch].quantile(0.50f) - offset) * scale,
+            (sketches[ch].quantile(0.90f) - offset) * scale, (sketches[ch].quantile(0.99f) - offset) * scale);
+    }
+}
+
+// "rate [hz]": print or change the sample rate
+void cli_rate(uint8_t argc, char** argv)
+{
+    uint32_t rate_hz = arg_uint(argc, argv, 1);
+    if (rate_hz != 0 && sampler_config.set_rate(rate_hz) != 0)
+    {
+        Serial.printf("Rejected %u Hz (limit: %u Hz)\r\n", (unsigned)rate_hz, (unsigned)sampler_config.max_rate_hz());
+    }
+    Serial.printf("Rate: %u Hz, %u cycles/sample%s\r\n", (unsigned)sampler_config.rate(),
+        (unsigned)source.cycles_per_frame(), source.cost_measured() ? "" : " (estimate, not measured yet)");
+}
+
+// "span [n]": print or change the moving average length
+void cli_span(uint8_t argc, char** argv)
+{
+    uint32_t len = arg_uint(argc, argv, 1);
+    if (len != 0 && moving_avg.set_len(len) != 0)
+    {
+        Serial.printf("Rejected span of %u (1..%u / channels)\r\n", (unsigned)len, (unsigned)AVG_HISTORY_LEN);
+    }
+    Serial.printf("Span: %u frames\r\n", (unsigned)moving_avg.requested_len());
+}
+
+// "stats": report sample block losses, latency and batching
+void cli_stats(uint8_t argc, char** argv)
+{
+    BufferStats stats = acquisition.stats();
+    Serial.printf("overruns: %u underruns: %u stalls: %u high water: %u/%u blocks\r\n",
+        (unsigned)stats.overruns, (unsigned)stats.underruns, (unsigned)stats.stalls,
+        (unsigned)stats.high_water, (unsigned)SAMPLE_BLOCK_CNT);
+    Serial.printf("latency: %u us (max %u us)\r\n", (unsigned)cli_res.latency_us, (unsigned)cli_res.latency_max_us);
+    Serial.printf("wakeups: %u blocks: %u\r\n", (unsigned)cli_res.wakeups, (unsigned)cli_res.blocks);
+}
+
+// "stream [on [baud] | off]": print or switch the binary block stream (see frame_stream.h)
+void cli_stream(uint8_t argc, char** argv)
+{
+    if (arg_is(argc, argv, 1, "off"))
+    {
+        stream.set_enabled(false);
+    }
+    Serial.printf("Stream: %s, %u frames, %u bytes sent, %u dropped (line too slow), %u baud\r\n",
+        stream.enabled() ? "on" : "off", (unsigned)stream.frames_sent(), (unsigned)stream.bytes_sent(),
+        (unsigned)stream.frames_dropped(), (unsigned)Serial.baudRate());
 
-        // Read values from buffer and calculate average
-        float tmp_avg = 0.;
-        for (int i = 0; i < BUF_LEN; i++)
+    if (arg_is(argc, argv, 1, "on"))
+    {
+        // Let the text out before the line speed changes and frames start
+        uint32_t baud = arg_uint(argc, argv, 2);
+        if (baud != 0)
         {
-            uint32_t val;
-            assert(circ_bbuf_pop(&my_circ_buf, &val) != -1);
-            tmp_avg += val;
+            Serial.printf("Switching to %u baud\r\n", (unsigned)baud);
+            Serial.flush();
+            Serial.updateBaudRate(baud);
         }
-        tmp_avg /= BUF_LEN;
-        // TODO: see if we need to add CS when storing tmp to global
-        avg = tmp_avg;
-        // TODO: see if we need to protect the buff idx
-        buf_idx = 0;
+        stream.set_enabled(true);
+    }
+}
+
+// "window [n]": print or change the frames per block (update rate)
+void cli_window(uint8_t argc, char** argv)
+{
+    uint32_t len = arg_uint(argc, argv, 1);
+    if (len != 0 && sampler_config.set_window_len(len > UINT16_MAX ? 0 : len) != 0)
+    {
+        Serial.printf("Rejected window of %u (1..%u)\r\n", (unsigned)len, (unsigned)SAMPLE_BLOCK_MAX);
+    }
+    Serial.printf("Window: %u frames\r\n", (unsigned)sampler_config.window_len());
+}
+
+// Every CLI command, sorted by name (checked at compile time) for the binary search in find_command()
+static constexpr Command commands[] = {
+    {"agg", cli_agg, "", "agg: last completed 1 s / 1 min / 1 h count, mean, min, max per channel"},
+    {"avg", cli_avg, "| bench", "avg [bench]: moving average per channel, or time float vs fixed-point means"},
+    {"channels", cli_channels, "<u>*", "channels [pin ...]: print or change the scanned pins"},
+    {"cpu", cli_cpu, "", "cpu: idle share of the sampling core over the next second"},
+    {"event", cli_event, "| reset | <u> off | <u> <u> <u> <u>?",
+        "event [reset | <ch> off | <ch> <high> <low> [max step]]: print or change the event rules"},
+    {"fft", cli_fft, "| peaks <u>? | <u> hann/hamming? <u>?",
+        "fft [peaks [k] | <size> [hann|hamming] [channel]]: print peaks or change the FFT, 0 = off"},
+    {"filter", cli_filter, "| fir <f>* | biquad <f>* | off | backend portable/esp-dsp | bench",
+        "filter [fir|biquad <coefs> | off | backend portable|esp-dsp | bench]"},
+    {"help", cli_help, "", "help: list the commands"},
+    {"isr", cli_isr, "| reset", "isr [reset]: print or clear the timer ISR histograms"},
+    {"metrics", cli_metrics, "", "metrics: min/max/mean/stddev/rms of the last window per channel"},
+    {"oversample", cli_oversample, "| <u> <u>?", "oversample [ratio [order]]: print or change the decimation"},
+    {"quantiles", cli_quantiles, "| reset", "quantiles [reset]: p50/p90/p99 per channel, or clear them"},
+    {"rate", cli_rate, "| <u>", "rate [hz]: print or change the sample rate"},
+    {"span", cli_span, "| <u>", "span [n]: print or change the frames per moving average"},
+    {"stats", cli_stats, "", "stats: block losses, latency and wake-ups"},
+    {"stream", cli_stream, "| on <u>? | off",
+        "stream [on [baud] | off]: binary block frames on this port, CLI text then breaks frames"},
+    {"window", cli_window, "| <u>", "window [n]: print or change the frames per block (update rate)"},
+};
+static_assert(commands_sorted(commands), "keep the command table sorted by name");
+
+// "help": list the commands
+void cli_help(uint8_t argc, char** argv)
+{
+    for (const Command& command : commands)
+    {
+        Serial.println(command.help);
+    }
+}
+
+// Called from the UART driver's event task whenever bytes arrive (or the line goes quiet)
+void on_serial_receive()
+{
+    if (taskHandleCLI != NULL)
+    {
+        xTaskNotifyGive(taskHandleCLI);
     }
 }
 
 void taskCLI(void* parameters)
 {
-    uint8_t cmd_len = strlen(avg_cmd);
     char c;
-    char cmd_buf[CMD_BUF_LEN];
-    uint8_t idx = 0;
+    static char cmd_buf[CMD_BUF_LEN]; // static, too big for the CLI task stack
+    char* argv[CLI_MAX_ARGS];
+    uint16_t idx = 0;
+    bool overflow = false; // line longer than the buffer, rejected as a whole
     memset(cmd_buf, 0, CMD_BUF_LEN); // Initially zero out the command buffer
 
     while (1)
     {
-        // Echo user input and check if they've entered the avg command
-        if (Serial.available() > 0)
+        // Sleep until on_serial_receive() reports input, the task takes no CPU while the line is idle
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Echo user input and run the command on newline
+        while (Serial.available() > 0)
         {
             c = Serial.read();
             Serial.print(c);
@@ -167,54 +959,99 @@ void taskCLI(void* parameters)
                 cmd_buf[idx] = c;
                 idx++;
             }
+            else
+            {
+                overflow = true;
+            }
 
-            // Check for avg command from user on newline (return)
+            // Look the command up on newline (return)
             if (c == '\n' || c == '\r')
             {
-                // User has entered avg command
-                if (memcmp(cmd_buf, avg_cmd, cmd_len) == 0)
+                // Arguments point into cmd_buf, nothing is copied
+                int argc = overflow ? 0 : tokenize(cmd_buf, argv, CLI_MAX_ARGS);
+                if (overflow)
+                {
+                    Serial.printf("Line too long (up to %u characters)\r\n", (unsigned)CMD_BUF_LEN - 1);
+                }
+                else if (argc < 0)
+                {
+                    Serial.printf("Too many arguments (up to %u)\r\n", (unsigned)CLI_MAX_ARGS - 1);
+                }
+                else if (argc > 0)
                 {
-                    char out[50];
-                    sprintf(out, "Average: %.2f", avg);
-                    Serial.println(avg);
+                    const Command* command = find_command(commands, argv[0]);
+                    if (command == NULL)
+                    {
+                        Serial.printf("Unknown command '%s', try help\r\n", argv[0]);
+                    }
+                    else if (!command_args_match(command->args, argc, argv))
+                    {
+                        Serial.printf("Usage: %s\r\n", command->help);
+                    }
+                    else
+                    {
+                        // One consistent copy of the latest results for whatever the command prints
+                        results.read(&cli_res);
+                        command->handler(argc, argv);
+                    }
                 }
 
                 // Clear buffer after user sends newline
                 memset(cmd_buf, 0, CMD_BUF_LEN);
                 idx = 0;
+                overflow = false;
             }
         }
-    }    
+    }
 }
 
 void setup()
 {
-    // Configure serial
+    // Configure serial, with room for a whole pasted command line and for stream frames to queue up
+    Serial.setRxBufferSize(CMD_BUF_LEN);
+    Serial.setTxBufferSize(STREAM_TX_BUF_LEN);
     Serial.begin(115200);
 
-   // Wait a moment to start (so we don't miss Serial output)
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    // Wait a moment to start (so we don't miss Serial output). No task of ours runs yet, so the idle loops
+    // counted on app_cpu meanwhile are the unloaded rate "cpu" compares against.
+    if (esp_register_freertos_idle_hook_for_cpu(idle_hook, app_cpu) == ESP_OK)
+    {
+        const uint32_t loops = idle_loops;
+        const int64_t start_us = esp_timer_get_time();
+        vTaskDelay(1000 / portTICK_PERIOD_MS);
+        idle_loops_per_s = (uint64_t)(idle_loops - loops) * 1000000 / (esp_timer_get_time() - start_us);
+    }
+    else
+    {
+        vTaskDelay(1000 / portTICK_PERIOD_MS);
+    }
     Serial.println();
     Serial.println("---FreeRTOS Hardware Interrupt Solution---");
 
-    // Configure hw timer
-    // Create and start timer - timerBegin is using the arduino esp32 api
-    timer = timerBegin(0 /*timer id*/, timer_div, true /*count up*/);
-
-    // Provide ISR to timer (timer, function, edge)
-    timerAttachInterrupt(timer, &onTimer, true);
-
-    // Configure timer count that should trigger ISR
-    // 1000000 = 1 second delay -- 10Hz = 1/10 = .1s (100ms)
-    timerAlarmWrite(timer, timer_max_count, true/*auto-reload*/);
-
-    timerAlarmEnable(timer);
-
     // Create tasks
     // Create CLI task with higher priority
-    xTaskCreatePinnedToCore(taskCLI, "taskClI", 2048, NULL, 2, NULL, app_cpu);
+    xTaskCreatePinnedToCore(taskCLI, "taskClI", 4096, NULL, 2, &taskHandleCLI, app_cpu);
+    // Wake the CLI from the UART driver instead of polling Serial.available()
+    Serial.onReceive(on_serial_receive);
     // Create average task with lower priority
-    xTaskCreatePinnedToCore(taskCalculateAverage, "taskClI", 2048, NULL, 1, &taskHandleCalculateAverage, app_cpu);
+    xTaskCreatePinnedToCore(taskCalculateAverage, "taskClI", 4096, NULL, 1, &taskHandleCalculateAverage, app_cpu);
+
+    // Create event handler task above everything else, pinned with the sources so cycle counts compare
+    xTaskCreatePinnedToCore(taskEventHandler, "taskEvents", 4096, NULL, 3, &taskHandleEvents, app_cpu);
+
+    // Start sampling once the consumer task exists
+    average_notifier.begin(taskHandleCalculateAverage);
+    event_notifier.begin(taskHandleEvents);
+    acquisition.begin(&average_notifier);
+    acquisition.detector().begin(&event_notifier);
+    if (!source.set_pins(adc_pins, sizeof(adc_pins) / sizeof(adc_pins[0])) || !source.begin(&acquisition, sample_rate_hz))
+    {
+        Serial.println("Failed to start sample source");
+    }
+#if defined(SAMPLE_SOURCE_SIM)
+    // Simulated source has no clock of its own, pace it from a task
+    xTaskCreatePinnedToCore(taskSimulate, "taskSimulate", 2048, NULL, 1, NULL, app_cpu);
+#endif
 
     // Delete the setup and loop task
     vTaskDelete(NULL);
@@ -0,0 +1,59 @@
+#include "sampler_config.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+static uint32_t getCpuFrequencyMhz() { return 240; } // host builds, the ESP32 default
+#endif
+
+SamplerConfig::SamplerConfig(SampleSource& source, Acquisition& acquisition)
+    : source_(source), acquisition_(acquisition)
+{
+}
+
+int SamplerConfig::set_rate(uint32_t rate_hz)
+{
+    uint16_t ratio = oversampling_ratio();
+    uint32_t max_rate = max_rate_hz(ratio);
+    if ((max_rate != 0 && rate_hz > max_rate) || (uint64_t)rate_hz * ratio > UINT32_MAX)
+    {
+        return -1;
+    }
+
+    return source_.set_rate(rate_hz * ratio) ? 0 : -1;
+}
+
+int SamplerConfig::set_oversampling(uint16_t ratio, uint8_t order)
+{
+    uint32_t rate_hz = rate();
+    uint32_t max_rate = max_rate_hz(ratio);
+    if (CicDecimator::check(ratio, order) != 0 || (max_rate != 0 && rate_hz > max_rate))
+    {
+        return -1;
+    }
+
+    // Speed the source up (or down) first, then let the producer switch filters at its next frame
+    uint32_t old_source_rate = source_.rate();
+    if (!source_.set_rate(rate_hz * ratio))
+    {
+        return -1;
+    }
+    if (acquisition_.set_decimation(ratio, order) != 0)
+    {
+        source_.set_rate(old_source_rate);
+        return -1;
+    }
+    return 0;
+}
+
+uint32_t SamplerConfig::max_rate_hz(uint16_t ratio) const
+{
+    uint32_t cycles = source_.cycles_per_frame();
+    if (cycles == 0)
+    {
+        return 0;
+    }
+
+    uint64_t budget = (uint64_t)getCpuFrequencyMhz() * 1000000 * CPU_BUDGET_PCT / 100;
+    return (uint32_t)(budget / cycles / ratio);
+}
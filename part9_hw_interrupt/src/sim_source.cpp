@@ -0,0 +1,131 @@
+#include "sim_source.h"
+
+#include <math.h>
+
+static const float two_pi = 6.28318530718f;
+
+SimulatedSource::SimulatedSource(const SimWaveform& wave)
+    : wave_(wave), recording_(NULL), recording_len_(0), recording_channels_(0)
+{
+    channels_ = 1; // pins are not used, default to a single channel
+}
+
+SimulatedSource::SimulatedSource(const sample_t* recording, size_t frame_cnt, uint8_t channels)
+    : wave_(), recording_(recording), recording_len_(frame_cnt), recording_channels_(channels)
+{
+    channels_ = channels;
+}
+
+bool SimulatedSource::begin(SampleSink* sink, uint32_t rate_hz)
+{
+    if (rate_hz == 0)
+    {
+        return false;
+    }
+    // A recording is replayed with its own layout, next_frame() reads it with stride channels_
+    if (recording_ != NULL && (recording_len_ == 0 || recording_channels_ == 0 ||
+        recording_channels_ > SAMPLE_MAX_CHANNELS || channels_ != recording_channels_))
+    {
+        return false;
+    }
+
+    sink_ = sink;
+    rate_hz_ = rate_hz;
+    reset_cost();
+    phase_step_ = two_pi * wave_.freq_hz / rate_hz;
+    phase_ = 0.f;
+    rng_ = 1;
+    recording_pos_ = 0;
+    clock_ns_ = 0;
+    return true;
+}
+
+void SimulatedSource::end()
+{
+    sink_ = NULL;
+}
+
+bool SimulatedSource::set_rate(uint32_t rate_hz)
+{
+    if (rate_hz == 0)
+    {
+        return false;
+    }
+
+    // Keep the phase so the waveform stays continuous
+    rate_hz_ = rate_hz;
+    reset_cost();
+    phase_step_ = two_pi * wave_.freq_hz / rate_hz;
+    return true;
+}
+
+size_t SimulatedSource::pump(size_t n)
+{
+    if (sink_ == NULL)
+    {
+        return 0;
+    }
+
+    sample_t chunk[CHUNK_LEN * SAMPLE_MAX_CHANNELS];
+    const uint32_t period_ns = 1000000000u / rate_hz_;
+    size_t done = 0;
+    while (done < n)
+    {
+        size_t len = (n - done < CHUNK_LEN) ? n - done : CHUNK_LEN;
+        for (size_t i = 0; i < len; i++)
+        {
+            next_frame(&chunk[i * channels_]);
+        }
+        sink_->on_frames(chunk, len, channels_, clock_ns_ / 1000, period_ns);
+        clock_ns_ += (uint64_t)len * period_ns;
+        done += len;
+    }
+    return done;
+}
+
+void SimulatedSource::next_frame(sample_t* frame)
+{
+    // Replay the recording in a loop
+    if (recording_ != NULL)
+    {
+        const sample_t* src = &recording_[recording_pos_ * channels_];
+        for (uint8_t c = 0; c < channels_; c++)
+        {
+            frame[c] = src[c];
+        }
+        recording_pos_ = (recording_pos_ + 1 == recording_len_) ? 0 : recording_pos_ + 1;
+        return;
+    }
+
+    // Same waveform on every channel, shifted by 1/channels of a period
+    for (uint8_t c = 0; c < channels_; c++)
+    {
+        float phase = phase_ + two_pi * c / channels_;
+        frame[c] = synth(phase >= two_pi ? phase - two_pi : phase);
+    }
+    phase_ += phase_step_;
+    if (phase_ >= two_pi)
+    {
+        phase_ -= two_pi;
+    }
+}
+
+sample_t SimulatedSource::synth(float phase)
+{
+    // Numerical Recipes LCG, top 24 bits mapped to [-1, 1)
+    rng_ = rng_ * 1664525u + 1013904223u;
+    float noise = ((float)(rng_ >> 8) / (float)(1u << 23) - 1.f) * wave_.noise;
+
+    float val = wave_.offset + wave_.amplitude * sinf(phase) + noise;
+
+    // Clamp to the ADC range like the real converter would
+    if (val <= 0.f)
+    {
+        return 0;
+    }
+    if (val >= ADC_MAX)
+    {
+        return ADC_MAX;
+    }
+    return (sample_t)(val + 0.5f);
+}
@@ -0,0 +1,205 @@
+#include "spectrum.h"
+
+#include <math.h>
+
+static const float two_pi = 6.28318530718f;
+
+static bool is_power_of_two(uint32_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(uint16_t size)
+    : config_(size | (uint32_t)FftWindow::Hann << 16)
+{
+    // Only table built with libm, once at boot
+    for (uint16_t i = 0; i <= MAX_SIZE / 4; i++)
+    {
+        sin_table_[i] = sinf(two_pi * i / MAX_SIZE);
+    }
+}
+
+int SpectrumAnalyzer::set_config(uint16_t size, FftWindow window, uint8_t channel)
+{
+    if ((size != 0 && (!is_power_of_two(size) || size < MIN_SIZE)) || size > MAX_SIZE ||
+        channel >= SAMPLE_MAX_CHANNELS || (window != FftWindow::Hann && window != FftWindow::Hamming))
+    {
+        return -1;
+    }
+
+    config_.store(size | (uint32_t)window << 16 | (uint32_t)channel << 24, std::memory_order_relaxed);
+    return 0;
+}
+
+float SpectrumAnalyzer::sin_lut(uint32_t j) const
+{
+    const uint32_t quarter = MAX_SIZE / 4;
+    j &= MAX_SIZE - 1;
+    if (j <= quarter)
+    {
+        return sin_table_[j];
+    }
+    if (j <= 2 * quarter)
+    {
+        return sin_table_[2 * quarter - j];
+    }
+    if (j <= 3 * quarter)
+    {
+        return -sin_table_[j - 2 * quarter];
+    }
+    return -sin_table_[4 * quarter - j];
+}
+
+void SpectrumAnalyzer::restart(const SampleBlock& block, uint32_t config)
+{
+    applied_config_ = config;
+    channels_ = block.channels;
+    frac_bits_ = block.frac_bits;
+    period_ns_ = block.period_ns;
+    fill_ = 0;
+    frames_done_ = 0;
+    peak_cnt_ = 0;
+}
+
+void SpectrumAnalyzer::push_block(const SampleBlock& block)
+{
+    const uint32_t config = config_.load(std::memory_order_relaxed);
+    if (config != applied_config_ || block.channels != channels_ || block.frac_bits != frac_bits_ ||
+        block.period_ns != period_ns_)
+    {
+        restart(block, config);
+    }
+
+    const uint8_t channel = config >> 24;
+    const uint16_t size = config & 0xFFFF;
+    if (size == 0 || channel >= block.channels)
+    {
+        return; // off, or the selected channel is not scanned
+    }
+
+    const float scale = 1.f / (1u << block.frac_bits);
+    for (uint16_t i = channel; i < block.len; i += block.channels)
+    {
+        in_[fill_++] = block.samples[i] * scale;
+        if (fill_ == size)
+        {
+            compute();
+            fill_ = 0;
+        }
+    }
+}
+
+void SpectrumAnalyzer::compute()
+{
+    const uint16_t n = applied_config_ & 0xFFFF;
+    const uint16_t m = n / 2; // complex FFT size
+    const FftWindow window = (FftWindow)((applied_config_ >> 16) & 0xFF);
+    const float a0 = window == FftWindow::Hann ? 0.5f : 0.54f;
+    const float a1 = 1.f - a0;
+    const uint32_t stride = MAX_SIZE / n; // table steps per 2*pi/n
+
+    // Remove the mean (DC would leak into the low bins), window, and pack even/odd samples as re/im
+    float mean = 0.f;
+    for (uint16_t i = 0; i < n; i++)
+    {
+        mean += in_[i];
+    }
+    mean /= n;
+    for (uint16_t i = 0; i < n; i++)
+    {
+        work_[i] = (in_[i] - mean) * (a0 - a1 * cos_lut(i * stride));
+    }
+
+    // Bit-reversal permutation of the m complex values
+    for (uint16_t i = 1, j = 0; i < m; i++)
+    {
+        uint16_t bit = m >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            float re = work_[2 * i], im = work_[2 * i + 1];
+            work_[2 * i] = work_[2 * j];
+            work_[2 * i + 1] = work_[2 * j + 1];
+            work_[2 * j] = re;
+            work_[2 * j + 1] = im;
+        }
+    }
+
+    // Iterative radix-2 butterflies, twiddle e^(-2*pi*i*k/len)
+    for (uint16_t len = 2; len <= m; len <<= 1)
+    {
+        const uint16_t half = len / 2;
+        const uint32_t step = MAX_SIZE / len;
+        for (uint16_t i = 0; i < m; i += len)
+        {
+            for (uint16_t k = 0; k < half; k++)
+            {
+                const float wr = cos_lut(k * step), wi = -sin_lut(k * step);
+                float* a = &work_[2 * (i + k)];
+                float* b = &work_[2 * (i + k + half)];
+                const float tr = wr * b[0] - wi * b[1];
+                const float ti = wr * b[1] + wi * b[0];
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+
+    // Split step: X[k] = E[k] + e^(-2*pi*i*k/n) O[k] with E/O the spectra of the even/odd samples.
+    // Scaled by 2 / sum(window) so a sine reads as its amplitude (DC and Nyquist by 1 / sum(window)).
+    const float gain = 2.f / (a0 * n);
+    for (uint16_t k = 0; k <= m; k++)
+    {
+        const uint16_t kk = k % m, mk = (m - k) % m;
+        const float zr = work_[2 * kk], zi = work_[2 * kk + 1];
+        const float cr = work_[2 * mk], ci = -work_[2 * mk + 1]; // conj(Z[m-k])
+        const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        const float or_ = 0.5f * (zi - ci), oi = -0.5f * (zr - cr); // (Z - conj) / 2i
+        const float wr = cos_lut(k * stride), wi = -sin_lut(k * stride);
+        const float xr = er + wr * or_ - wi * oi;
+        const float xi = ei + wr * oi + wi * or_;
+        mag_[k] = sqrtf(xr * xr + xi * xi) * (k == 0 || k == m ? gain / 2 : gain);
+    }
+
+    bin_hz_ = period_ns_ != 0 ? 1e9f / period_ns_ / n : 0.f;
+    frames_done_++;
+    find_peaks(m + 1);
+}
+
+// Largest local maxima of the spectrum (DC excluded), largest first
+void SpectrumAnalyzer::find_peaks(uint16_t bins)
+{
+    peak_cnt_ = 0;
+    for (uint16_t k = 1; k + 1 < bins; k++)
+    {
+        const float y0 = mag_[k - 1], y1 = mag_[k], y2 = mag_[k + 1];
+        if (!(y1 > y0 && y1 >= y2))
+        {
+            continue;
+        }
+        if (peak_cnt_ == MAX_PEAKS && y1 <= peaks_[MAX_PEAKS - 1].magnitude)
+        {
+            continue;
+        }
+
+        // Parabola through the three bins for the sub-bin position and height
+        const float denom = y0 - 2.f * y1 + y2;
+        const float delta = denom != 0.f ? 0.5f * (y0 - y2) / denom : 0.f;
+        SpectralPeak peak = {(k + delta) * bin_hz_, y1 - 0.25f * (y0 - y2) * delta};
+
+        // Insert sorted, dropping the smallest when full
+        uint8_t pos = peak_cnt_ < MAX_PEAKS ? peak_cnt_++ : MAX_PEAKS - 1;
+        while (pos > 0 && peaks_[pos - 1].magnitude < peak.magnitude)
+        {
+            peaks_[pos] = peaks_[pos - 1];
+            pos--;
+        }
+        peaks_[pos] = peak;
+    }
+}
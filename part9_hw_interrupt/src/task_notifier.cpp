@@ -0,0 +1,21 @@
+#include "task_notifier.h"
+
+void IRAM_ATTR TaskNotifier::notify(uint32_t bits)
+{
+    if (xPortInIsrContext())
+    {
+        BaseType_t task_woken = pdFALSE; // Keeps track of the task status
+        xTaskNotifyFromISR(task_, bits, eSetBits, &task_woken);
+
+        // Use task_woken to check if the task is awoken from the notification
+        // and if so, immediately context switch to it via portYIELD_FROM_ISR()
+        if (task_woken)
+        {
+            portYIELD_FROM_ISR();
+        }
+    }
+    else
+    {
+        xTaskNotify(task_, bits, eSetBits);
+    }
+}
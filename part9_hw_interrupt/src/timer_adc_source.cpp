@@ -0,0 +1,114 @@
+#include "timer_adc_source.h"
+
+#include <esp_timer.h>
+#include <xtensa/core-macros.h>
+
+// Timer runs at 80MHz APB / 2 = 40MHz, fine enough to resolve the ISR entry latency
+static const uint16_t timer_div = 2; // prescaler, smallest the timer supports
+static const uint32_t timer_hz = 40000000;
+
+TimerAdcSource* TimerAdcSource::active_ = NULL;
+
+TimerAdcSource::TimerAdcSource(uint8_t timer_id)
+    : timer_id_(timer_id)
+{
+}
+
+bool TimerAdcSource::begin(SampleSink* sink, uint32_t rate_hz)
+{
+    if (active_ != NULL || channels_ == 0 || rate_hz == 0 || rate_hz > timer_hz)
+    {
+        return false;
+    }
+
+    sink_ = sink;
+    active_ = this;
+    rate_hz_ = rate_hz;
+    reset_cost();
+    cycles_per_tick_ = getCpuFrequencyMhz() * 1000000 / timer_hz;
+    period_cycles_ = getCpuFrequencyMhz() * 1000000 / rate_hz;
+    have_last_entry_ = false;
+
+    // Create and start timer - timerBegin is using the arduino esp32 api
+    timer_ = timerBegin(timer_id_, timer_div, true /*count up*/);
+
+    // Provide ISR to timer (timer, function, edge)
+    timerAttachInterrupt(timer_, &onTimer, true);
+
+    // Configure timer count that should trigger ISR
+    // 40000000 = 1 second delay -- 10Hz = 1/10 = .1s (100ms)
+    timerAlarmWrite(timer_, timer_hz / rate_hz, true /*auto-reload*/);
+    timerAlarmEnable(timer_);
+    return true;
+}
+
+bool TimerAdcSource::set_rate(uint32_t rate_hz)
+{
+    if (timer_ == NULL || rate_hz == 0 || rate_hz > timer_hz)
+    {
+        return false;
+    }
+
+    // Re-arm in place, the ISR and the block being filled keep going.
+    // Restart the count so a shorter period does not have to wait for the counter to wrap.
+    timerAlarmWrite(timer_, timer_hz / rate_hz, true /*auto-reload*/);
+    timerWrite(timer_, 0);
+    rate_hz_ = rate_hz;
+    reset_cost();
+    period_cycles_ = getCpuFrequencyMhz() * 1000000 / rate_hz;
+    have_last_entry_ = false; // the next interval is cut short by the restart
+    return true;
+}
+
+void TimerAdcSource::reset_timing()
+{
+    timing_.latency.reset();
+    timing_.exec.reset();
+    timing_.jitter.reset();
+}
+
+void TimerAdcSource::end()
+{
+    if (timer_ == NULL)
+    {
+        return;
+    }
+
+    timerAlarmDisable(timer_);
+    timerDetachInterrupt(timer_);
+    timerEnd(timer_);
+    timer_ = NULL;
+    active_ = NULL;
+}
+
+// Interrupt Service Routines
+// IRAM_ATTR = specify that the function is loaded into internal ram instead of flash
+// Scan every configured pin and hand the frame to the sink
+void IRAM_ATTR TimerAdcSource::onTimer()
+{
+    uint32_t start = xthal_get_ccount();
+    TimerAdcSource* self = active_;
+    uint32_t since_alarm = (uint32_t)timerRead(self->timer_); // counter restarted at the alarm
+    uint64_t timestamp_us = esp_timer_get_time(); // capture before the (slow) conversions
+
+    sample_t frame[SAMPLE_MAX_CHANNELS];
+    for (uint8_t i = 0; i < self->channels_; i++)
+    {
+        frame[i] = analogRead(self->pins_[i]);
+    }
+    self->sink_->on_frames(frame, 1, self->channels_, timestamp_us, 1000000000u / self->rate_hz_);
+
+    // Timing instrumentation, a few dozen cycles in total
+    uint32_t end = xthal_get_ccount();
+    self->record_cost(end - start, 1);
+    self->timing_.latency.record(since_alarm * self->cycles_per_tick_);
+    self->timing_.exec.record(end - start);
+    if (self->have_last_entry_)
+    {
+        uint32_t interval = start - self->last_entry_;
+        self->timing_.jitter.record(interval > self->period_cycles_ ?
+            interval - self->period_cycles_ : self->period_cycles_ - interval);
+    }
+    self->last_entry_ = start;
+    self->have_last_entry_ = true;
+}
@@ -0,0 +1,195 @@
+/*
+Host tests for AggregatePyramid against aggregates computed directly from the samples.
+
+Over an hour and a bit of a 1 kHz two channel stream, starting mid-hour so the first window of every
+level is partial, each completed 1 s, 1 min and 1 h window must have exactly the count, sum, min and max
+of the frames whose timestamps fall in it. Also: blocks with different decimation fraction bits merge in
+one unit, a gap in the stream skips windows instead of stretching them, and a channel change or a filter
+offset starts over.
+*/
+
+#include <stdio.h>
+#include <unity.h>
+#include "aggregate_pyramid.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint64_t T0_US = 3570000000ull; // 59 min 30 s, half a minute before the first hour ends
+static const uint32_t PERIOD_US = 1000;
+static const uint8_t CHANNELS = 2;
+static const uint16_t BLOCK_FRAMES = 250;
+
+static SampleBlock block;
+
+// Sample of channel c in frame f, 12-bit, random access so any window can be recomputed
+static sample_t value(uint64_t f, uint8_t c)
+{
+    uint32_t h = (uint32_t)(f * CHANNELS + c) * 2654435761u;
+    h ^= h >> 15;
+    h *= 2246822519u;
+    h ^= h >> 13;
+    return h & 0xFFF;
+}
+
+static void fill_block(uint64_t first, uint16_t frames, uint8_t channels, uint8_t frac_bits)
+{
+    block.reset();
+    block.channels = channels;
+    block.frac_bits = frac_bits;
+    block.t0_us = T0_US + first * PERIOD_US;
+    block.period_ns = PERIOD_US * 1000;
+    for (uint16_t f = 0; f < frames; f++)
+    {
+        block.jitter_us[f] = 0;
+        for (uint8_t c = 0; c < channels; c++)
+        {
+            block.samples[f * channels + c] = value(first + f, c) >> frac_bits << frac_bits;
+        }
+    }
+    block.len = frames * channels;
+}
+
+// Aggregate of channel c over the frames in [start_us, start_us + len_us), in pyramid units
+static Aggregate reference(uint64_t start_us, uint64_t len_us, uint8_t c)
+{
+    Aggregate agg;
+    agg.clear();
+    agg.start_us = start_us;
+    const uint64_t first = start_us > T0_US ? (start_us - T0_US + PERIOD_US - 1) / PERIOD_US : 0;
+    for (uint64_t f = first; T0_US + f * PERIOD_US < start_us + len_us; f++)
+    {
+        const uint32_t v = (uint32_t)value(f, c) << AggregatePyramid::FRAC_BITS;
+        agg.count++;
+        agg.sum += v;
+        agg.min = v < agg.min ? v : agg.min;
+        agg.max = v > agg.max ? v : agg.max;
+    }
+    return agg;
+}
+
+static void test_matches_reference()
+{
+    static AggregatePyramid pyramid;
+    const uint64_t frames = (7300000000ull - T0_US) / PERIOD_US; // to 2 h 1 min 40 s
+    uint64_t checked_start[AggregatePyramid::LEVELS] = {UINT64_MAX, UINT64_MAX, UINT64_MAX};
+    uint32_t checked[AggregatePyramid::LEVELS] = {};
+    uint32_t errors = 0;
+    for (uint64_t first = 0; first < frames; first += BLOCK_FRAMES)
+    {
+        fill_block(first, BLOCK_FRAMES, CHANNELS, 0);
+        pyramid.push_block(block);
+
+        for (uint8_t level = 0; level < AggregatePyramid::LEVELS; level++)
+        {
+            const uint64_t len_us = AggregatePyramid::LEVEL_US[level];
+            const Aggregate& last = pyramid.last(level, 0);
+            if (last.count == 0 || last.start_us == checked_start[level])
+            {
+                continue;
+            }
+            checked_start[level] = last.start_us;
+            checked[level]++;
+            errors += last.start_us % len_us != 0;
+            for (uint8_t c = 0; c < CHANNELS; c++)
+            {
+                const Aggregate& got = pyramid.last(level, c);
+                const Aggregate want = reference(last.start_us, len_us, c);
+                errors += got.start_us != want.start_us || got.count != want.count || got.sum != want.sum ||
+                          got.min != want.min || got.max != want.max;
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, errors);
+    // Every second from 59:30 to 2:01:38, the minutes from 59 to 2:00, the partial and the full hour
+    TEST_ASSERT_EQUAL(3729, checked[0]);
+    TEST_ASSERT_EQUAL(62, checked[1]);
+    TEST_ASSERT_EQUAL(2, checked[2]);
+    TEST_ASSERT_EQUAL(3600000, pyramid.last(2, 1).count);
+    TEST_ASSERT_EQUAL(60000, pyramid.last(1, 1).count);
+    TEST_ASSERT_EQUAL(1000, pyramid.last(0, 1).count);
+}
+
+static void test_fraction_bits_merge()
+{
+    static AggregatePyramid pyramid;
+    fill_block(0, 500, 1, 0);
+    for (uint16_t i = 0; i < block.len; i++)
+    {
+        block.samples[i] = 100;
+    }
+    pyramid.push_block(block);
+
+    // Same level after 2 bits of decimation gain
+    fill_block(500, 500, 1, 2);
+    for (uint16_t i = 0; i < block.len; i++)
+    {
+        block.samples[i] = 400;
+    }
+    pyramid.push_block(block);
+    fill_block(1000, 1, 1, 0); // next second, closes the first
+    pyramid.push_block(block);
+
+    const Aggregate& agg = pyramid.last(0, 0);
+    TEST_ASSERT_EQUAL(1000, agg.count);
+    TEST_ASSERT_EQUAL(100u << AggregatePyramid::FRAC_BITS, agg.min);
+    TEST_ASSERT_EQUAL(100u << AggregatePyramid::FRAC_BITS, agg.max);
+    TEST_ASSERT_EQUAL(1000ull * (100u << AggregatePyramid::FRAC_BITS), agg.sum);
+}
+
+static void test_gap_skips_windows()
+{
+    static AggregatePyramid pyramid;
+    fill_block(0, 250, CHANNELS, 0); // 59:30
+    pyramid.push_block(block);
+    fill_block(125000, 250, CHANNELS, 0); // 61:35, nothing in between
+    pyramid.push_block(block);
+    TEST_ASSERT_EQUAL(T0_US, pyramid.last(0, 0).start_us);
+    TEST_ASSERT_EQUAL(250, pyramid.last(0, 0).count);
+
+    fill_block(126000, 1, CHANNELS, 0); // 61:36 closes 61:35, which belongs to a new minute
+    pyramid.push_block(block);
+    TEST_ASSERT_EQUAL(T0_US + 125000000ull, pyramid.last(0, 1).start_us);
+    TEST_ASSERT_EQUAL(3540000000ull, pyramid.last(1, 1).start_us); // minute 59, only the first block
+    TEST_ASSERT_EQUAL(250, pyramid.last(1, 1).count);
+    TEST_ASSERT_EQUAL(reference(T0_US, 250 * PERIOD_US, 1).sum, pyramid.last(1, 1).sum);
+    TEST_ASSERT_EQUAL(0, pyramid.last(2, 1).count); // hour 0 closes with the first minute of hour 1
+    TEST_ASSERT_EQUAL(3660000000ull, pyramid.current(1, 1).start_us); // minute 61, minute 60 never existed
+    TEST_ASSERT_EQUAL(250, pyramid.current(2, 1).count);
+}
+
+static void test_channel_change_starts_over()
+{
+    static AggregatePyramid pyramid;
+    fill_block(0, 1000, 1, 0);
+    pyramid.push_block(block);
+    fill_block(1000, 1, 1, 0);
+    pyramid.push_block(block);
+    TEST_ASSERT_EQUAL(1000, pyramid.last(0, 0).count);
+
+    fill_block(1001, 100, 3, 0);
+    pyramid.push_block(block);
+    TEST_ASSERT_EQUAL(3, pyramid.channels());
+    TEST_ASSERT_EQUAL(0, pyramid.last(0, 0).count);
+    TEST_ASSERT_EQUAL(100, pyramid.current(0, 2).count);
+    TEST_ASSERT_EQUAL(0, pyramid.current(1, 0).count);
+
+    // Switching a DC-blocking filter on changes what the values mean, so that starts over too
+    TEST_ASSERT_EQUAL(0, pyramid.offset());
+    fill_block(1101, 100, 3, 1);
+    block.offset = 2048 << 1;
+    pyramid.push_block(block);
+    TEST_ASSERT_EQUAL(2048u << AggregatePyramid::FRAC_BITS, pyramid.offset());
+    TEST_ASSERT_EQUAL(100, pyramid.current(0, 2).count);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_fraction_bits_merge);
+    RUN_TEST(test_gap_skips_windows);
+    RUN_TEST(test_channel_change_starts_over);
+    return UNITY_END();
+}
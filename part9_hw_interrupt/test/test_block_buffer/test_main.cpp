@@ -0,0 +1,165 @@
+/*
+Host simulation of the BlockBuffer handoff: a producer thread fills and publishes blocks while a consumer
+thread acquires, checks and releases them, under each overflow policy.
+
+Ownership is tracked per block index. Each side marks a block as held while it works on it, and any block
+found already held by the other side is an error. The producer also stamps every word of a block with
+its sequence number, and the consumer checks the stamp when it acquires the block and again after
+yielding to the producer. A block handed out while still being written or reclaimed would show up as a
+double hold or a torn or changed stamp.
+*/
+
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include "block_buffer.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct TestBlock
+{
+    static const uint32_t EMPTY = 0xFFFFFFFF;
+
+    uint32_t seq;
+    uint32_t words[64];
+
+    void reset() { seq = EMPTY; }
+};
+
+static const size_t BLOCKS = 3;
+static const uint32_t PUBLISHES = 200000;
+
+template <OverflowPolicy P>
+static void run_handoff()
+{
+    static BlockBuffer<TestBlock, BLOCKS, P> bb;
+    TestBlock* const base = bb.write_block(); // block 0, the first write block
+    std::atomic<int> holders[BLOCKS] = {};
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> errors{0};
+
+    std::thread producer([&]() {
+        uint32_t seq = 0;
+        uint32_t published = 0;
+        while (published < PUBLISHES)
+        {
+            TestBlock* b = bb.write_block();
+            if (b == NULL)
+            {
+                // Backpressure: the filled block is held back, retry once the consumer has freed one
+                if (bb.publish() >= 0)
+                {
+                    published++;
+                    seq++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+                continue;
+            }
+
+            const size_t idx = b - base;
+            if (holders[idx].fetch_add(1) != 0)
+            {
+                errors++;
+            }
+            for (uint32_t& w : b->words)
+            {
+                w = seq;
+            }
+            b->seq = seq;
+            holders[idx].fetch_sub(1);
+
+            const int res = bb.publish();
+            if (res >= 0)
+            {
+                if ((size_t)res != idx)
+                {
+                    errors++;
+                }
+                published++;
+                seq++;
+            }
+            else if (P != OverflowPolicy::Backpressure)
+            {
+                published++; // dropped, counted as an overrun
+                seq++;
+            }
+            std::this_thread::yield(); // the next block takes a while to fill
+        }
+        done.store(true);
+    });
+
+    uint32_t received = 0;
+    uint32_t last = TestBlock::EMPTY;
+    while (1)
+    {
+        TestBlock* b = bb.acquire();
+        if (b == NULL)
+        {
+            if (done.load() && bb.ready_count() == 0)
+            {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        const size_t idx = b - base;
+        if (holders[idx].fetch_add(1) != 0)
+        {
+            errors++;
+        }
+        const uint32_t seq = b->seq;
+        bool ok = seq != TestBlock::EMPTY && (last == TestBlock::EMPTY || seq > last);
+        if (P == OverflowPolicy::Backpressure)
+        {
+            ok = ok && seq == received; // nothing may be lost
+        }
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (uint32_t w : b->words)
+            {
+                ok = ok && w == seq;
+            }
+            ok = ok && b->seq == seq;
+            std::this_thread::yield(); // give the producer a chance to touch the block if it wrongly can
+        }
+        if (!ok)
+        {
+            errors++;
+        }
+        last = seq;
+        received++;
+        holders[idx].fetch_sub(1);
+        bb.release(b);
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL(0, errors.load());
+    const BufferStats stats = bb.stats();
+    TEST_ASSERT_EQUAL(PUBLISHES, received + stats.overruns);
+    if (P == OverflowPolicy::Backpressure)
+    {
+        TEST_ASSERT_EQUAL(PUBLISHES, received);
+    }
+    char line[96];
+    snprintf(line, sizeof(line), "%u blocks received, %u overruns, %u stalls", (unsigned)received,
+        (unsigned)stats.overruns, (unsigned)stats.stalls);
+    TEST_MESSAGE(line);
+}
+
+static void test_handoff_drop_newest() { run_handoff<OverflowPolicy::DropNewest>(); }
+static void test_handoff_overwrite_oldest() { run_handoff<OverflowPolicy::OverwriteOldest>(); }
+static void test_handoff_backpressure() { run_handoff<OverflowPolicy::Backpressure>(); }
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_handoff_drop_newest);
+    RUN_TEST(test_handoff_overwrite_oldest);
+    RUN_TEST(test_handoff_backpressure);
+    return UNITY_END();
+}
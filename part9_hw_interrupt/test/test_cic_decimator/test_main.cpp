@@ -0,0 +1,136 @@
+/*
+Host tests for CicDecimator against the ideal CIC response, for every ratio/order pair check() accepts.
+
+- DC: a constant input settles to exactly in << extra_bits(), full scale included (no register overflow).
+- Frequency response: a sine at input frequency f (cycles per input sample) must come out with the
+  amplitude scaled by |sin(pi f R) / (R sin(pi f))|^N, the sinc^N magnitude normalized to unity DC gain.
+  The test frequencies sit below the output Nyquist rate so nothing aliases; the output amplitude at f
+  is measured by correlating an integer number of output cycles.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include "cic_decimator.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const double PI = 3.14159265358979323846;
+
+// Ideal magnitude, 1 at DC
+static double sinc_n(double f, uint16_t ratio, uint8_t order)
+{
+    if (ratio == 1)
+    {
+        return 1.0;
+    }
+    return pow(fabs(sin(PI * f * ratio) / (ratio * sin(PI * f))), order);
+}
+
+// Feed frames inputs, call out(sample) for every output
+template <typename In, typename Out>
+static void run(CicDecimator& cic, uint32_t inputs, In in, Out out)
+{
+    for (uint32_t n = 0; n < inputs; n++)
+    {
+        sample_t y;
+        if (cic.push(in(n), &y))
+        {
+            out(y);
+        }
+    }
+}
+
+static void test_dc_gain()
+{
+    uint32_t pairs = 0;
+    for (uint8_t order = 1; order <= CicDecimator::MAX_ORDER; order++)
+    {
+        for (uint32_t ratio = 1; ratio <= 32768; ratio *= 2)
+        {
+            if (CicDecimator::check(ratio, order) != 0)
+            {
+                continue;
+            }
+            pairs++;
+            const sample_t levels[] = {0, 1, 1234, 4095};
+            for (sample_t level : levels)
+            {
+                CicDecimator cic;
+                cic.configure(ratio, order);
+                uint32_t outputs = 0;
+                bool ok = true;
+                // order outputs to fill the comb delays, then a few settled ones
+                run(cic, (order + 4) * ratio, [level](uint32_t) { return level; }, [&](sample_t y) {
+                    if (outputs++ >= order && y != (uint32_t)level << cic.extra_bits())
+                    {
+                        ok = false;
+                    }
+                });
+                char msg[64];
+                snprintf(msg, sizeof(msg), "ratio %u order %u level %u", (unsigned)ratio, order, level);
+                TEST_ASSERT_TRUE_MESSAGE(ok, msg);
+                TEST_ASSERT_EQUAL_MESSAGE(order + 4, outputs, msg);
+            }
+        }
+    }
+    // order 1 up to 32768, order 2 up to 1024, order 3 up to 64, order 4 up to 32
+    TEST_ASSERT_EQUAL(16 + 11 + 7 + 6, pairs);
+}
+
+static void test_frequency_response()
+{
+    static const uint32_t M = 256; // output samples correlated
+    static const uint32_t CYCLES[] = {8, 32, 64, 100}; // output cycles in M, up to 0.39 of the output rate
+    static const double A = 1500.0;
+
+    for (uint8_t order = 1; order <= CicDecimator::MAX_ORDER; order++)
+    {
+        for (uint32_t ratio = 1; ratio <= 32768; ratio *= 2)
+        {
+            if (CicDecimator::check(ratio, order) != 0)
+            {
+                continue;
+            }
+            for (uint32_t k : CYCLES)
+            {
+                const double f = (double)k / M / ratio; // cycles per input sample
+                CicDecimator cic;
+                cic.configure(ratio, order);
+                const double scale = 1 << cic.extra_bits();
+
+                double re = 0.0;
+                double im = 0.0;
+                uint32_t m = 0;
+                run(cic, (order + M) * ratio,
+                    [f](uint32_t n) { return (sample_t)lround(2048.0 + A * sin(2 * PI * f * n)); },
+                    [&](sample_t y) {
+                        if (m >= order)
+                        {
+                            const double phase = 2 * PI * k * (m - order) / M;
+                            re += y * cos(phase);
+                            im += y * sin(phase);
+                        }
+                        m++;
+                    });
+                const double measured = 2.0 * sqrt(re * re + im * im) / M / scale;
+                const double expected = A * sinc_n(f, ratio, order);
+
+                char msg[96];
+                snprintf(msg, sizeof(msg), "ratio %u order %u f_out %.3f: expected %.3f got %.3f", (unsigned)ratio,
+                    order, (double)k / M, expected, measured);
+                // Input and output rounding add well under one output count of error
+                TEST_ASSERT_DOUBLE_WITHIN_MESSAGE(0.5 + 0.002 * expected, expected, measured, msg);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dc_gain);
+    RUN_TEST(test_frequency_response);
+    return UNITY_END();
+}
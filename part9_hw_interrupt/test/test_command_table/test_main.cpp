@@ -0,0 +1,134 @@
+/*
+Host tests for the CLI dispatch helpers: tokenize(), find_command() and the argument patterns that
+command_args_match() checks before a handler runs.
+*/
+
+#include <unity.h>
+#include "command_table.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void handler(uint8_t, char**) {}
+
+static constexpr Command table[] = {
+    {"avg", handler, "| bench", "avg [bench]"},
+    {"event", handler, "| reset | <u> off | <u> <u> <u> <u>?", "event [reset | <ch> off | <ch> <high> <low> [step]]"},
+    {"fft", handler, "| peaks <u>? | <u> hann/hamming? <u>?", "fft [peaks [k] | <size> [hann|hamming] [channel]]"},
+    {"filter", handler, "| fir <f>* | off | backend portable/esp-dsp", "filter [fir <taps> | off | backend <name>]"},
+    {"rate", handler, "| <u>", "rate [hz]"},
+};
+static_assert(commands_sorted(table), "test table must be sorted");
+
+// Tokenize line and check it against the pattern of its command
+static bool accepted(const char* line)
+{
+    static char buf[128];
+    char* argv[16];
+    strncpy(buf, line, sizeof(buf) - 1);
+    const int argc = tokenize(buf, argv, 16);
+    TEST_ASSERT_GREATER_THAN(0, argc);
+    const Command* command = find_command(table, argv[0]);
+    TEST_ASSERT_NOT_NULL(command);
+    return command_args_match(command->args, argc, argv);
+}
+
+static void test_tokenize_in_place()
+{
+    char line[] = "  filter\tfir 0.5  0.5\r\n";
+    char* argv[4];
+    TEST_ASSERT_EQUAL(4, tokenize(line, argv, 4));
+    TEST_ASSERT_EQUAL_STRING("filter", argv[0]);
+    TEST_ASSERT_EQUAL_STRING("fir", argv[1]);
+    TEST_ASSERT_EQUAL_STRING("0.5", argv[3]);
+    TEST_ASSERT_TRUE(argv[0] >= line && argv[3] < line + sizeof(line)); // pointers into the line
+
+    char full[] = "a b c d e";
+    TEST_ASSERT_EQUAL(-1, tokenize(full, argv, 4));
+}
+
+static void test_find_exact_names()
+{
+    TEST_ASSERT_EQUAL_PTR(&table[0], find_command(table, "avg"));
+    TEST_ASSERT_EQUAL_PTR(&table[4], find_command(table, "rate"));
+    TEST_ASSERT_NULL(find_command(table, "av"));
+    TEST_ASSERT_NULL(find_command(table, "avgfoo"));
+    TEST_ASSERT_NULL(find_command(table, "zzz"));
+}
+
+static void test_numbers()
+{
+    TEST_ASSERT_TRUE(is_uint_arg("0"));
+    TEST_ASSERT_TRUE(is_uint_arg("4294967295"));
+    TEST_ASSERT_FALSE(is_uint_arg("4294967296"));
+    TEST_ASSERT_FALSE(is_uint_arg("99999999999999999999999"));
+    TEST_ASSERT_FALSE(is_uint_arg("-1"));
+    TEST_ASSERT_FALSE(is_uint_arg("+1"));
+    TEST_ASSERT_FALSE(is_uint_arg("12abc"));
+    TEST_ASSERT_FALSE(is_uint_arg("abc"));
+    TEST_ASSERT_FALSE(is_uint_arg(""));
+
+    TEST_ASSERT_TRUE(is_float_arg("0.25"));
+    TEST_ASSERT_TRUE(is_float_arg("-1e-3"));
+    TEST_ASSERT_TRUE(is_float_arg("3"));
+    TEST_ASSERT_FALSE(is_float_arg("0.25x"));
+    TEST_ASSERT_FALSE(is_float_arg("nan"));
+    TEST_ASSERT_FALSE(is_float_arg("inf"));
+    TEST_ASSERT_FALSE(is_float_arg("1e99"));
+    TEST_ASSERT_FALSE(is_float_arg(""));
+}
+
+static void test_patterns_accept_well_formed_lines()
+{
+    TEST_ASSERT_TRUE(accepted("avg"));
+    TEST_ASSERT_TRUE(accepted("avg bench"));
+    TEST_ASSERT_TRUE(accepted("event"));
+    TEST_ASSERT_TRUE(accepted("event reset"));
+    TEST_ASSERT_TRUE(accepted("event 2 off"));
+    TEST_ASSERT_TRUE(accepted("event 0 3000 1000"));
+    TEST_ASSERT_TRUE(accepted("event 0 3000 1000 50"));
+    TEST_ASSERT_TRUE(accepted("fft peaks"));
+    TEST_ASSERT_TRUE(accepted("fft peaks 3"));
+    TEST_ASSERT_TRUE(accepted("fft 1024"));
+    TEST_ASSERT_TRUE(accepted("fft 1024 hamming"));
+    TEST_ASSERT_TRUE(accepted("fft 1024 2"));
+    TEST_ASSERT_TRUE(accepted("fft 1024 hann 2"));
+    TEST_ASSERT_TRUE(accepted("filter fir"));
+    TEST_ASSERT_TRUE(accepted("filter fir 0.25 0.5 0.25"));
+    TEST_ASSERT_TRUE(accepted("filter backend esp-dsp"));
+    TEST_ASSERT_TRUE(accepted("rate"));
+    TEST_ASSERT_TRUE(accepted("rate 1000"));
+}
+
+static void test_patterns_reject_malformed_lines()
+{
+    TEST_ASSERT_FALSE(accepted("avg foo"));
+    TEST_ASSERT_FALSE(accepted("avg bench now"));
+    TEST_ASSERT_FALSE(accepted("event foo off")); // used to clear channel 0
+    TEST_ASSERT_FALSE(accepted("event 0"));
+    TEST_ASSERT_FALSE(accepted("event 0 3000"));
+    TEST_ASSERT_FALSE(accepted("event 0 3000 1000 50 7"));
+    TEST_ASSERT_FALSE(accepted("event -1 off"));
+    TEST_ASSERT_FALSE(accepted("fft 1024 hanning")); // used to select channel 0
+    TEST_ASSERT_FALSE(accepted("fft 1024 2 hann")); // channel before the window
+    TEST_ASSERT_FALSE(accepted("fft peaks x"));
+    TEST_ASSERT_FALSE(accepted("fft big"));
+    TEST_ASSERT_FALSE(accepted("filter fir 0.25 abc"));
+    TEST_ASSERT_FALSE(accepted("filter backend"));
+    TEST_ASSERT_FALSE(accepted("filter backend fast"));
+    TEST_ASSERT_FALSE(accepted("filter of"));
+    TEST_ASSERT_FALSE(accepted("rate abc")); // used to print the state
+    TEST_ASSERT_FALSE(accepted("rate 10x"));
+    TEST_ASSERT_FALSE(accepted("rate 1000 2000"));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tokenize_in_place);
+    RUN_TEST(test_find_exact_names);
+    RUN_TEST(test_numbers);
+    RUN_TEST(test_patterns_accept_well_formed_lines);
+    RUN_TEST(test_patterns_reject_malformed_lines);
+    return UNITY_END();
+}
@@ -0,0 +1,182 @@
+/*
+Host tests for EventDetector, fed frame by frame without a source.
+
+Hysteresis fires once per crossing however much the signal chatters between low and high, the first
+sample after a (re)start only sets the state (a start inside the band counts as low), slope events fire
+both ways on steps above the limit, rules are per channel and validated, and a handler that falls behind
+loses the newest events and sees them counted, with one wake-up per queued event.
+*/
+
+#include <unity.h>
+#include "event_detector.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Counts wake-ups
+class CountingNotifier : public Notifier
+{
+public:
+    uint32_t wakeups = 0;
+
+    void notify(uint32_t bits) override { wakeups += bits == 1; }
+};
+
+// Feed a single channel signal, frame i stamped i ms
+static void feed(EventDetector& det, const sample_t* signal, size_t len, uint64_t first_ms = 0)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        det.check(&signal[i], 1, (first_ms + i) * 1000);
+    }
+}
+
+static uint32_t count_events(EventDetector& det, EventKind kind)
+{
+    uint32_t n = 0;
+    DetectorEvent ev;
+    while (det.pop(&ev) == 0)
+    {
+        n += ev.kind == kind;
+    }
+    return n;
+}
+
+static void test_hysteresis_does_not_chatter()
+{
+    static EventDetector det;
+    CountingNotifier handler;
+    det.begin(&handler);
+    TEST_ASSERT_EQUAL(0, det.set_rule(0, EventDetector::Rule{2000, 1000, 0}));
+
+    // Starts low, noise around each threshold, one real rise and one real fall
+    const sample_t signal[] = {500, 900, 1100, 990, 1999, 2000, 1990, 2100, 1999, 1001, 1500, 1000, 2500};
+    feed(det, signal, sizeof(signal) / sizeof(signal[0]));
+
+    DetectorEvent ev;
+    TEST_ASSERT_EQUAL(0, det.pop(&ev));
+    TEST_ASSERT_EQUAL(EventKind::Rising, ev.kind);
+    TEST_ASSERT_EQUAL(2000, ev.value);
+    TEST_ASSERT_EQUAL(5000, ev.timestamp_us);
+    TEST_ASSERT_EQUAL(0, det.pop(&ev));
+    TEST_ASSERT_EQUAL(EventKind::Falling, ev.kind);
+    TEST_ASSERT_EQUAL(1000, ev.value);
+    TEST_ASSERT_EQUAL(11000, ev.timestamp_us);
+    TEST_ASSERT_EQUAL(0, det.pop(&ev));
+    TEST_ASSERT_EQUAL(EventKind::Rising, ev.kind);
+    TEST_ASSERT_EQUAL(12000, ev.timestamp_us);
+    TEST_ASSERT_EQUAL(-1, det.pop(&ev));
+    TEST_ASSERT_EQUAL(3, handler.wakeups);
+}
+
+static void test_restart_takes_the_state_without_firing()
+{
+    static EventDetector det;
+    det.set_rule(0, EventDetector::Rule{2000, 1000, 0});
+    const sample_t high[] = {3000, 3000};
+    feed(det, high, 2); // already high at the start: no Rising
+    TEST_ASSERT_EQUAL(0, count_events(det, EventKind::Rising));
+
+    // A new rule restarts the channel, the next sample sets the state again
+    det.set_rule(0, EventDetector::Rule{2500, 1500, 0});
+    const sample_t low_then_high[] = {1000, 2600};
+    feed(det, low_then_high, 2);
+    TEST_ASSERT_EQUAL(1, count_events(det, EventKind::Rising));
+
+    // A start inside the band counts as low, the first rise through high fires
+    det.set_rule(0, EventDetector::Rule{2400, 1600, 0});
+    const sample_t in_band_then_high[] = {2000, 2200, 2500, 2000, 1500};
+    feed(det, in_band_then_high, 5);
+    DetectorEvent ev;
+    TEST_ASSERT_EQUAL(0, det.pop(&ev));
+    TEST_ASSERT_EQUAL(EventKind::Rising, ev.kind);
+    TEST_ASSERT_EQUAL(2000, ev.timestamp_us);
+    TEST_ASSERT_EQUAL(0, det.pop(&ev));
+    TEST_ASSERT_EQUAL(EventKind::Falling, ev.kind);
+    TEST_ASSERT_EQUAL(-1, det.pop(&ev));
+
+    // So does a change of channel count
+    const sample_t frame[2] = {100, 100};
+    det.check(frame, 2, 0);
+    det.check(frame, 2, 1000);
+    TEST_ASSERT_EQUAL(0, count_events(det, EventKind::Falling));
+    const sample_t up[2] = {3000, 100};
+    det.check(up, 2, 2000);
+    TEST_ASSERT_EQUAL(1, count_events(det, EventKind::Rising));
+}
+
+static void test_slope_both_ways_per_channel()
+{
+    static EventDetector det;
+    TEST_ASSERT_EQUAL(0, det.set_rule(1, EventDetector::Rule{0, 0, 100}));
+
+    // ch0 has no rule and jumps around, ch1 steps 100 (at the limit), then +101 and -101
+    const sample_t frames[][2] = {{0, 1000}, {4000, 1100}, {0, 1200}, {4000, 1301}, {0, 1200}};
+    for (size_t i = 0; i < 5; i++)
+    {
+        det.check(frames[i], 2, i * 1000);
+    }
+
+    DetectorEvent ev;
+    TEST_ASSERT_EQUAL(0, det.pop(&ev));
+    TEST_ASSERT_EQUAL(EventKind::Slope, ev.kind);
+    TEST_ASSERT_EQUAL(1, ev.channel);
+    TEST_ASSERT_EQUAL(1301, ev.value);
+    TEST_ASSERT_EQUAL(3000, ev.timestamp_us);
+    TEST_ASSERT_EQUAL(0, det.pop(&ev));
+    TEST_ASSERT_EQUAL(1200, ev.value);
+    TEST_ASSERT_EQUAL(-1, det.pop(&ev));
+}
+
+static void test_rule_validation()
+{
+    static EventDetector det;
+    TEST_ASSERT_EQUAL(-1, det.set_rule(SAMPLE_MAX_CHANNELS, EventDetector::Rule{2000, 1000, 0}));
+    TEST_ASSERT_EQUAL(-1, det.set_rule(0, EventDetector::Rule{1000, 1000, 0})); // low must be below high
+    TEST_ASSERT_EQUAL(-1, det.set_rule(0, EventDetector::Rule{1000, 2000, 0}));
+    TEST_ASSERT_EQUAL(0, det.set_rule(0, EventDetector::Rule{0, 5000, 0})); // levels off, low ignored
+    TEST_ASSERT_EQUAL(0, det.set_rule(3, EventDetector::Rule{4000, 10, 7}));
+    const EventDetector::Rule rule = det.rule(3);
+    TEST_ASSERT_EQUAL(4000, rule.high);
+    TEST_ASSERT_EQUAL(10, rule.low);
+    TEST_ASSERT_EQUAL(7, rule.max_step);
+}
+
+static void test_slow_handler_drops_newest()
+{
+    static EventDetector det;
+    CountingNotifier handler;
+    det.begin(&handler);
+    det.set_rule(0, EventDetector::Rule{0, 0, 10});
+
+    // Every step fires, twice the queue length of them
+    for (size_t i = 0; i <= 2 * EventDetector::EVENT_QUEUE_LEN; i++)
+    {
+        const sample_t x = i % 2 ? 1000 : 0;
+        det.check(&x, 1, i * 1000);
+    }
+    TEST_ASSERT_EQUAL(EventDetector::EVENT_QUEUE_LEN, handler.wakeups);
+    TEST_ASSERT_EQUAL(EventDetector::EVENT_QUEUE_LEN, det.dropped());
+
+    DetectorEvent ev;
+    uint64_t last_us = 0;
+    uint32_t n = 0;
+    while (det.pop(&ev) == 0)
+    {
+        last_us = ev.timestamp_us;
+        n++;
+    }
+    TEST_ASSERT_EQUAL(EventDetector::EVENT_QUEUE_LEN, n);
+    TEST_ASSERT_EQUAL(EventDetector::EVENT_QUEUE_LEN * 1000, last_us); // the oldest ones were kept
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hysteresis_does_not_chatter);
+    RUN_TEST(test_restart_takes_the_state_without_firing);
+    RUN_TEST(test_slope_both_ways_per_channel);
+    RUN_TEST(test_rule_validation);
+    RUN_TEST(test_slow_handler_drops_newest);
+    return UNITY_END();
+}
@@ -0,0 +1,418 @@
+/*
+Tests for FilterBank against a double reference, plus a throughput figure per backend.
+
+- FIR and biquad kernels match a direct double convolution / difference equation, whatever the block
+  split (the state carried between blocks must make the result independent of it).
+- process() filters every channel of an interleaved block on its own, rounds and clamps the result, and
+  applies a staged config on the next block.
+- A sine through a high-pass comes out whole around the mid-scale offset recorded in the block, instead
+  of losing its negative half-cycles to the clamp. Designs that pass DC get no offset.
+- With esp-dsp built in (on the ESP32, pio test -e esp32dev_test) both backends must agree sample for
+  sample and can be switched between blocks without a glitch. On the host only the portable one exists.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "filter_bank.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+typedef FilterBank::Backend Backend;
+
+static const uint16_t N = 1000;
+static const uint8_t TAPS = FilterBank::FIR_MAX_TAPS;
+
+// Low-pass windowed sinc, and two biquads (low-pass at 0.1 fs, high-pass at 0.01 fs, Q 0.707)
+static float taps[TAPS];
+static float taps_rev[TAPS];
+static const float BIQUADS[2][FilterBank::BIQUAD_COEFS] = {
+    {0.067455f, 0.134911f, 0.067455f, -1.142980f, 0.412802f},
+    {0.956543f, -1.913087f, 0.956543f, -1.911197f, 0.914976f},
+};
+
+static float input[N];
+static double reference[N];
+
+static void make_filters()
+{
+    for (uint8_t k = 0; k < TAPS; k++)
+    {
+        const double m = k - (TAPS - 1) / 2.0;
+        const double sinc = m == 0 ? 0.2 : sin(0.2 * M_PI * m) / (M_PI * m);
+        taps[k] = (float)(sinc * (0.54 - 0.46 * cos(2 * M_PI * k / (TAPS - 1))));
+        taps_rev[TAPS - 1 - k] = taps[k];
+    }
+}
+
+// Noise plus a step, in ADC counts
+static void make_input()
+{
+    uint32_t rng = 7;
+    for (uint16_t i = 0; i < N; i++)
+    {
+        rng = rng * 1664525u + 1013904223u;
+        input[i] = (float)((i < N / 2 ? 1000 : 3000) + (rng >> 24));
+    }
+}
+
+static void fir_reference(uint8_t count)
+{
+    for (uint16_t n = 0; n < N; n++)
+    {
+        double acc = 0.0;
+        for (uint8_t k = 0; k < count && k <= n; k++)
+        {
+            acc += (double)taps[k] * input[n - k];
+        }
+        reference[n] = acc;
+    }
+}
+
+static void biquad_reference(const float* c)
+{
+    double w1 = 0.0;
+    double w2 = 0.0;
+    for (uint16_t n = 0; n < N; n++)
+    {
+        const double w0 = input[n] - c[3] * w1 - c[4] * w2;
+        reference[n] = c[0] * w0 + c[1] * w1 + c[2] * w2;
+        w2 = w1;
+        w1 = w0;
+    }
+}
+
+// Kernel over the whole input in blocks of split samples, the state carried across
+static void run_fir(Backend backend, uint8_t count, uint16_t split, float* out)
+{
+    float history[TAPS - 1] = {};
+    memcpy(out, input, sizeof(input));
+    for (uint16_t i = 0; i < N; i += split)
+    {
+        const uint16_t len = N - i < split ? N - i : split;
+        FilterBank::fir(backend, &taps_rev[TAPS - count], count, history, &out[i], len);
+    }
+}
+
+static void run_biquad(Backend backend, const float* c, uint16_t split, float* out)
+{
+    float w[2] = {};
+    memcpy(out, input, sizeof(input));
+    for (uint16_t i = 0; i < N; i += split)
+    {
+        const uint16_t len = N - i < split ? N - i : split;
+        FilterBank::biquad(backend, c, w, &out[i], len);
+    }
+}
+
+// Worst error relative to the reference, in counts. Float accumulation of up to 64 products of values
+// around 4000 stays well under a hundredth of a count.
+static void assert_matches(const float* out, double tolerance, const char* what)
+{
+    for (uint16_t n = 0; n < N; n++)
+    {
+        if (fabs(out[n] - reference[n]) > tolerance)
+        {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "%s: sample %u is %.4f, expected %.4f", what, n, out[n], reference[n]);
+            TEST_FAIL_MESSAGE(msg);
+        }
+    }
+}
+
+static const uint16_t SPLITS[] = {N, 256, 63, 64, 65, 7, 1};
+
+static void test_fir_matches_reference()
+{
+    static float out[N];
+    const uint8_t counts[] = {1, 2, 5, 32, TAPS};
+    for (uint8_t count : counts)
+    {
+        fir_reference(count);
+        for (uint16_t split : SPLITS)
+        {
+            run_fir(Backend::Portable, count, split, out);
+            char what[48];
+            snprintf(what, sizeof(what), "%u taps, blocks of %u", count, split);
+            assert_matches(out, 0.01, what);
+        }
+    }
+}
+
+static void test_biquad_matches_reference()
+{
+    static float out[N];
+    for (const float* c : BIQUADS)
+    {
+        biquad_reference(c);
+        for (uint16_t split : SPLITS)
+        {
+            run_biquad(Backend::Portable, c, split, out);
+            char what[48];
+            snprintf(what, sizeof(what), "biquad a1 %.3f, blocks of %u", c[3], split);
+            // Direct form II state runs at input / (1 + a1 + a2), about 265 times the input for the
+            // high-pass, so float rounding there shows up as a tenth of a count or so
+            assert_matches(out, 0.5, what);
+        }
+    }
+}
+
+static void fill_block(SampleBlock& block, uint16_t frames, uint8_t channels, uint32_t seed)
+{
+    block.reset();
+    block.channels = channels;
+    for (uint16_t f = 0; f < frames; f++)
+    {
+        for (uint8_t c = 0; c < channels; c++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            block.samples[f * channels + c] = (c + 1) * 1000 + (seed >> 25);
+        }
+    }
+    block.len = frames * channels;
+}
+
+static void test_process_per_channel()
+{
+    static FilterBank bank;
+    static SampleBlock block;
+    static SampleBlock copy;
+    const float gain[] = {30.f};
+    TEST_ASSERT_EQUAL(0, bank.set_fir(gain, 1));
+    TEST_ASSERT_EQUAL(-1, bank.set_fir(gain, 1)); // not picked up yet
+
+    // x30 takes channel 2 (3000 and up) past full scale, which must clamp, the others fit exactly
+    fill_block(block, 100, 3, 1);
+    copy = block;
+    bank.process(block);
+    for (uint16_t i = 0; i < block.len; i++)
+    {
+        const uint32_t expected = 30u * copy.samples[i];
+        TEST_ASSERT_EQUAL(expected > UINT16_MAX ? UINT16_MAX : expected, block.samples[i]);
+    }
+
+    // A 3 tap moving sum on each channel, history kept per channel across blocks
+    const float ones[] = {1.f, 1.f, 1.f};
+    TEST_ASSERT_EQUAL(0, bank.set_fir(ones, 3));
+    uint32_t prev[3][2] = {};
+    for (uint32_t round = 0; round < 3; round++)
+    {
+        fill_block(block, 50, 3, round + 10);
+        copy = block;
+        bank.process(block);
+        for (uint16_t f = 0; f < 50; f++)
+        {
+            for (uint8_t c = 0; c < 3; c++)
+            {
+                const uint32_t x = copy.samples[f * 3 + c];
+                TEST_ASSERT_EQUAL(x + prev[c][0] + prev[c][1], block.samples[f * 3 + c]);
+                prev[c][1] = prev[c][0];
+                prev[c][0] = x;
+            }
+        }
+    }
+
+    // Cleared: blocks go through untouched
+    TEST_ASSERT_EQUAL(0, bank.clear());
+    fill_block(block, 100, 3, 99);
+    copy = block;
+    bank.process(block);
+    TEST_ASSERT_EQUAL_MEMORY(copy.samples, block.samples, block.len * sizeof(sample_t));
+}
+
+static void test_high_pass_keeps_both_half_cycles()
+{
+    static FilterBank bank;
+    static SampleBlock block;
+    static SampleBlock copy;
+    const float diff[] = {1.f, -1.f};
+    const float* high_pass = BIQUADS[1];
+    block.reset();
+    block.channels = 1;
+    block.len = 1; // just to apply each staged config
+
+    // DC gain decides: the low-pass and a plain gain pass DC, the high-pass and a difference do not
+    TEST_ASSERT_EQUAL(0, bank.set_biquads(BIQUADS[0], 1));
+    TEST_ASSERT_FALSE(bank.offsets_output());
+    bank.process(block);
+    TEST_ASSERT_EQUAL(0, bank.set_fir(diff, 2));
+    TEST_ASSERT_TRUE(bank.offsets_output());
+    bank.process(block);
+    TEST_ASSERT_EQUAL(0, bank.set_fir(diff, 0));
+    bank.process(block);
+    TEST_ASSERT_EQUAL(0, bank.set_biquads(high_pass, 1));
+    TEST_ASSERT_TRUE(bank.offsets_output());
+
+    // 2000 +- 1000 counts at fs/20, well above the 0.01 fs corner, with one fraction bit. Past the first
+    // blocks (the DC step settling) the output swings the full +-1000 around the offset.
+    const uint16_t frames = 200;
+    const sample_t offset = FilterBank::MID_SCALE << 1;
+    int32_t lo = 0, hi = 0;
+    for (uint16_t round = 0; round < 10; round++)
+    {
+        block.reset();
+        block.channels = 1;
+        block.frac_bits = 1;
+        for (uint16_t f = 0; f < frames; f++)
+        {
+            block.samples[f] = (sample_t)lround(2 * (2000.0 + 1000.0 * sin(2 * M_PI * (round * frames + f) / 20)));
+        }
+        block.len = frames;
+        copy = block;
+        bank.process(block);
+        TEST_ASSERT_EQUAL(offset, block.offset);
+        if (round < 5)
+        {
+            continue;
+        }
+        for (uint16_t f = 0; f < frames; f++)
+        {
+            const int32_t y = (int32_t)block.samples[f] - offset;
+            lo = y < lo ? y : lo;
+            hi = y > hi ? y : hi;
+        }
+    }
+    TEST_ASSERT_INT_WITHIN(2 * 20, -2 * 1000, lo);
+    TEST_ASSERT_INT_WITHIN(2 * 20, 2 * 1000, hi);
+
+    // Back to no filter: untouched and no offset
+    TEST_ASSERT_EQUAL(0, bank.clear());
+    copy.reset();
+    copy.channels = 1;
+    copy.len = 1;
+    copy.samples[0] = 1234;
+    bank.process(copy);
+    TEST_ASSERT_EQUAL(0, copy.offset);
+    TEST_ASSERT_EQUAL(1234, copy.samples[0]);
+}
+
+static void test_backends_agree()
+{
+    if (!FilterBank::has_esp_dsp())
+    {
+        TEST_IGNORE_MESSAGE("esp-dsp not built in, run on the ESP32 with pio test -e esp32dev_test");
+    }
+
+    static float portable[N];
+    static float esp_dsp[N];
+    for (uint16_t split : SPLITS)
+    {
+        run_fir(Backend::Portable, TAPS, split, portable);
+        run_fir(Backend::EspDsp, TAPS, split, esp_dsp);
+        for (uint16_t n = 0; n < N; n++)
+        {
+            TEST_ASSERT_FLOAT_WITHIN(0.01f, portable[n], esp_dsp[n]);
+        }
+        for (const float* c : BIQUADS)
+        {
+            run_biquad(Backend::Portable, c, split, portable);
+            run_biquad(Backend::EspDsp, c, split, esp_dsp);
+            for (uint16_t n = 0; n < N; n++)
+            {
+                TEST_ASSERT_FLOAT_WITHIN(0.01f, portable[n], esp_dsp[n]);
+            }
+        }
+    }
+
+    // Alternating backends block by block gives the same stream, the state format is shared
+    static float mixed[N];
+    run_fir(Backend::Portable, TAPS, N, portable);
+    float history[TAPS - 1] = {};
+    memcpy(mixed, input, sizeof(input));
+    for (uint16_t i = 0; i < N; i += 100)
+    {
+        FilterBank::fir(i % 200 ? Backend::EspDsp : Backend::Portable, taps_rev, TAPS, history, &mixed[i], 100);
+    }
+    for (uint16_t n = 0; n < N; n++)
+    {
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, portable[n], mixed[n]);
+    }
+}
+
+static uint64_t elapsed_us()
+{
+#if defined(ARDUINO)
+    return micros();
+#else
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+#endif
+}
+
+// Samples per second through 64 taps and through 4 biquads, per backend
+static void test_throughput()
+{
+    static float x[256];
+    const Backend backends[] = {Backend::Portable, Backend::EspDsp};
+    for (Backend backend : backends)
+    {
+        if (backend == Backend::EspDsp && !FilterBank::has_esp_dsp())
+        {
+            continue;
+        }
+        const uint32_t rounds = 200;
+        float history[TAPS - 1] = {};
+        float w[2] = {};
+        memcpy(x, input, sizeof(x));
+
+        uint64_t t0 = elapsed_us();
+        for (uint32_t r = 0; r < rounds; r++)
+        {
+            FilterBank::fir(backend, taps_rev, TAPS, history, x, 256);
+        }
+        const uint64_t fir_us = elapsed_us() - t0;
+        t0 = elapsed_us();
+        for (uint32_t r = 0; r < rounds; r++)
+        {
+            for (uint8_t s = 0; s < 4; s++)
+            {
+                FilterBank::biquad(backend, BIQUADS[s % 2], w, x, 256);
+            }
+        }
+        const uint64_t biquad_us = elapsed_us() - t0;
+
+        char msg[112];
+        snprintf(msg, sizeof(msg), "%s: %u taps %.0f ksamples/s, 4 biquads %.0f ksamples/s",
+            backend == Backend::EspDsp ? "esp-dsp" : "portable", TAPS, rounds * 256e3 / (fir_us ? fir_us : 1),
+            rounds * 256e3 / (biquad_us ? biquad_us : 1));
+        TEST_MESSAGE(msg);
+        TEST_ASSERT_TRUE(isfinite(x[0]));
+    }
+}
+
+static int run_tests()
+{
+    make_filters();
+    make_input();
+    UNITY_BEGIN();
+    RUN_TEST(test_fir_matches_reference);
+    RUN_TEST(test_biquad_matches_reference);
+    RUN_TEST(test_process_per_channel);
+    RUN_TEST(test_high_pass_keeps_both_half_cycles);
+    RUN_TEST(test_backends_agree);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
+
+#if defined(ARDUINO)
+void setup()
+{
+    delay(2000); // let the test runner open the port
+    run_tests();
+}
+
+void loop() {}
+#else
+int main(int argc, char** argv)
+{
+    return run_tests();
+}
+#endif
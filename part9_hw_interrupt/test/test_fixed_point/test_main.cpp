@@ -0,0 +1,118 @@
+/*
+Host accuracy tests for the fixed-point mean against a double reference.
+
+Every window length 1..65536 and every input fraction width 0..4 (the decimator's extra bits) is run
+with sums at the edges of the range (0, 1, the largest sum of n full-scale samples), at exact
+half-LSB rounding ties and at pseudo-random values. fixed_mean<16>() must stay within 1 LSB of the
+exactly rounded Q16.16 mean, as fixed_point.h promises.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include "fixed_point.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Exact sum / (n * 2^in_frac) in units of 2^-F. sum * 2^16 < 2^48 is exact in a double.
+static double reference(uint32_t sum, uint32_t n, uint8_t in_frac, uint8_t F)
+{
+    return (double)sum * (1u << F) / ((double)n * (1u << in_frac));
+}
+
+static void test_mean_within_one_lsb()
+{
+    uint32_t rng = 1;
+    uint64_t checked = 0;
+    double worst = 0.0;
+    for (uint32_t n = 1; n <= 65536; n++)
+    {
+        const Reciprocal r = reciprocal(n);
+        for (uint8_t in_frac = 0; in_frac <= 4; in_frac++)
+        {
+            // Full-scale 12-bit samples carrying in_frac fraction bits
+            const uint32_t max_sample = 4095u << in_frac;
+            const uint32_t max_sum = (uint32_t)((uint64_t)max_sample * n);
+            rng = rng * 1664525u + 1013904223u;
+            const uint32_t sums[] = {
+                0,
+                1,
+                max_sum,
+                max_sum - 1,
+                (uint32_t)((uint64_t)rng * max_sum >> 32),
+                // sum / n lands exactly on half an LSB of the Q16.16 result (when n allows it)
+                (uint32_t)(((2ull * (n / 3) + 1) * n << in_frac) >> 17),
+            };
+            for (uint32_t sum : sums)
+            {
+                const double exact = reference(sum, n, in_frac, 16);
+                const double err = fabs((double)fixed_mean<16>(sum, r, in_frac) - exact);
+                if (err > worst)
+                {
+                    worst = err;
+                }
+                if (err > 1.0)
+                {
+                    char msg[96];
+                    snprintf(msg, sizeof(msg), "n %u in_frac %u sum %u: %.3f LSB off", (unsigned)n, in_frac,
+                        (unsigned)sum, err);
+                    TEST_FAIL_MESSAGE(msg);
+                }
+                checked++;
+            }
+        }
+    }
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%llu means checked, worst %.3f LSB", (unsigned long long)checked, worst);
+    TEST_MESSAGE(msg);
+}
+
+// Fewer fraction bits, same bound relative to the output LSB
+static void test_coarser_outputs()
+{
+    for (uint32_t n = 1; n <= 65536; n += 7)
+    {
+        const Reciprocal r = reciprocal(n);
+        const uint32_t sum = (uint32_t)(4095ull * n * 2 / 3);
+        TEST_ASSERT_DOUBLE_WITHIN(1.0, reference(sum, n, 0, 8), fixed_mean<8>(sum, r, 0));
+        TEST_ASSERT_DOUBLE_WITHIN(1.0, reference(sum, n, 0, 0), fixed_mean<0>(sum, r, 0));
+    }
+}
+
+static void test_reciprocal_fits()
+{
+    for (uint32_t n = 1; n <= 65536; n++)
+    {
+        const Reciprocal r = reciprocal(n);
+        // mul / 2^shift is 1/n to within half a step of mul
+        const double err = fabs(ldexp((double)r.mul, -r.shift) - 1.0 / n) * ldexp(1.0, r.shift);
+        TEST_ASSERT_LESS_OR_EQUAL(0.5, err);
+        TEST_ASSERT_GREATER_OR_EQUAL(1u << 31, r.mul);
+    }
+}
+
+static void test_printing_parts()
+{
+    uint32_t int_part;
+    uint32_t decimals;
+    q16_16_parts((2048u << 16) + 0x8000, 2, &int_part, &decimals); // 2048.5
+    TEST_ASSERT_EQUAL(2048, int_part);
+    TEST_ASSERT_EQUAL(50, decimals);
+    q16_16_parts((7u << 16) + 0xFFFF, 2, &int_part, &decimals); // 7.99998 rounds up to 8.00
+    TEST_ASSERT_EQUAL(8, int_part);
+    TEST_ASSERT_EQUAL(0, decimals);
+    q16_16_parts(0x0001, 3, &int_part, &decimals);
+    TEST_ASSERT_EQUAL(0, int_part);
+    TEST_ASSERT_EQUAL(0, decimals);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_mean_within_one_lsb);
+    RUN_TEST(test_coarser_outputs);
+    RUN_TEST(test_reciprocal_fits);
+    RUN_TEST(test_printing_parts);
+    return UNITY_END();
+}
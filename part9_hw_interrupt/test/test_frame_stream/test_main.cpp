@@ -0,0 +1,247 @@
+/*
+Host tests for the binary block stream: FrameStream on one end, FrameDecoder (tools/frame_decoder.h) on
+the other.
+
+- Loopback over a pseudo-terminal: a writer thread streams blocks into the pty master, including runs of
+  zero and 0xFF bytes that stress the COBS groups, with CLI-like text injected once; the decoder reads the
+  slave and must get every other block back exactly, reject the one the text landed in and see no gaps.
+- A full output drops the frame instead of waiting, counts it, and the next frame's sequence number
+  shows the gap to the host.
+*/
+
+#include <fcntl.h>
+#include <pty.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <unity.h>
+#include "frame_decoder.h"
+#include "frame_stream.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Writes into a file descriptor and claims unlimited room, so the writer blocks on a full pty instead of
+// dropping: the loopback test wants every frame through
+class FdOutput : public FrameOutput
+{
+public:
+    explicit FdOutput(int fd) : fd_(fd) {}
+
+    size_t available_for_write() override { return SIZE_MAX; }
+
+    void write(const uint8_t* data, size_t len) override
+    {
+        while (len > 0)
+        {
+            const ssize_t n = ::write(fd_, data, len);
+            if (n <= 0)
+            {
+                return;
+            }
+            data += n;
+            len -= n;
+        }
+    }
+
+private:
+    int fd_;
+};
+
+// Collects what is written, with a fixed amount of room
+class BufferOutput : public FrameOutput
+{
+public:
+    size_t room = SIZE_MAX;
+    uint8_t data[8192];
+    size_t len = 0;
+
+    size_t available_for_write() override { return room; }
+
+    void write(const uint8_t* bytes, size_t n) override
+    {
+        memcpy(&data[len], bytes, n);
+        len += n;
+    }
+};
+
+static const uint32_t BLOCKS = 50;
+static const uint32_t TEXT_BEFORE = 20; // text is written into the middle of this block's frame
+
+// Block b of the test stream: varying layout and content, some blocks all zero or all 0xFF
+static void make_block(SampleBlock& block, uint32_t b)
+{
+    block.reset();
+    block.channels = 1 + b % 4;
+    block.frac_bits = b % 3;
+    block.t0_us = 1000000ull * b + 17;
+    block.period_ns = 50000 + b;
+    const uint16_t frames = 1 + (b * 37) % (SAMPLE_BLOCK_MAX / block.channels);
+    uint32_t rng = b + 1;
+    for (uint16_t i = 0; i < frames * block.channels; i++)
+    {
+        rng = rng * 1664525u + 1013904223u;
+        block.samples[i] = b % 5 == 1 ? 0 : b % 5 == 2 ? 0xFFFF : (sample_t)(rng >> 16);
+    }
+    block.len = frames * block.channels;
+}
+
+static void test_crc_check_value()
+{
+    const uint8_t text[] = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, FrameStream::crc32(0, text, 9));
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, FrameDecoder::crc32(text, 9));
+    // Split in two, the firmware carries the CRC across the header and the samples
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, FrameStream::crc32(FrameStream::crc32(0, text, 4), &text[4], 5));
+}
+
+static void test_pty_loopback()
+{
+    int master;
+    int slave;
+    TEST_ASSERT_EQUAL(0, openpty(&master, &slave, NULL, NULL, NULL));
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    // Unity asserts only on the main thread, the writer reports back through these
+    uint32_t write_failures = 0;
+    uint32_t frames_sent = 0;
+    std::thread writer([&]() {
+        static SampleBlock block;
+        FdOutput out(master);
+        FrameStream stream(out);
+        stream.set_enabled(true);
+        for (uint32_t b = 0; b < BLOCKS; b++)
+        {
+            make_block(block, b);
+            if (b == TEXT_BEFORE)
+            {
+                // Half a frame, then CLI text, then the frame starts over: the first try must be rejected
+                BufferOutput staged;
+                FrameStream half(staged);
+                half.set_enabled(true);
+                half.write_block(block);
+                out.write(staged.data, staged.len / 2);
+                const char text[] = "Rate: 20000 Hz\r\n";
+                out.write((const uint8_t*)text, sizeof(text) - 1);
+                out.write(staged.data + staged.len / 2, staged.len - staged.len / 2);
+            }
+            write_failures += stream.write_block(block) != 0;
+        }
+        frames_sent = stream.frames_sent();
+    });
+
+    static FrameDecoder decoder;
+    static SampleBlock expected;
+    uint32_t next = 0;
+    uint32_t mismatches = 0;
+    uint8_t buf[4096];
+    while (next < BLOCKS)
+    {
+        const ssize_t n = read(slave, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            break;
+        }
+        decoder.feed(buf, n, [&](const DecodedFrame& frame) {
+            make_block(expected, next);
+            if (frame.seq != next || frame.channels != expected.channels ||
+                frame.frac_bits != expected.frac_bits || frame.frames != expected.frames() ||
+                frame.t0_us != expected.t0_us || frame.period_ns != expected.period_ns)
+            {
+                mismatches++;
+            }
+            else
+            {
+                for (uint16_t i = 0; i < expected.len; i++)
+                {
+                    mismatches += frame.sample(i) != expected.samples[i];
+                }
+            }
+            next++;
+        });
+    }
+    writer.join();
+    close(slave);
+    close(master);
+
+    TEST_ASSERT_EQUAL(0, write_failures);
+    TEST_ASSERT_EQUAL(BLOCKS, frames_sent);
+    TEST_ASSERT_EQUAL(BLOCKS, next);
+    TEST_ASSERT_EQUAL(0, mismatches);
+    TEST_ASSERT_EQUAL(1, decoder.totals().bad); // the frame the text landed in
+    TEST_ASSERT_EQUAL(0, decoder.totals().lost); // the resent copy keeps the sequence intact
+    TEST_ASSERT_EQUAL(BLOCKS, decoder.totals().good);
+}
+
+static void test_full_output_drops_and_counts()
+{
+    static SampleBlock block;
+    static FrameDecoder decoder;
+    BufferOutput out;
+    FrameStream stream(out);
+    TEST_ASSERT_EQUAL(-1, stream.write_block(block)); // off
+    stream.set_enabled(true);
+
+    make_block(block, 3);
+    const size_t worst = FrameStream::max_encoded_len(block.len * sizeof(sample_t));
+    out.room = worst;
+    TEST_ASSERT_EQUAL(0, stream.write_block(block));
+    TEST_ASSERT_LESS_OR_EQUAL(worst, out.len);
+
+    // One byte short of the worst case: nothing may be written, not even part of the frame
+    const size_t sent = out.len;
+    out.room = worst - 1;
+    TEST_ASSERT_EQUAL(-1, stream.write_block(block));
+    TEST_ASSERT_EQUAL(sent, out.len);
+    TEST_ASSERT_EQUAL(1, stream.frames_dropped());
+    TEST_ASSERT_EQUAL(1, stream.frames_sent());
+
+    out.room = SIZE_MAX;
+    TEST_ASSERT_EQUAL(0, stream.write_block(block));
+    TEST_ASSERT_EQUAL(2, stream.frames_sent());
+
+    uint32_t seqs[2];
+    uint32_t got = 0;
+    decoder.feed(out.data, out.len, [&](const DecodedFrame& frame) { seqs[got++] = frame.seq; });
+    TEST_ASSERT_EQUAL(2, got);
+    TEST_ASSERT_EQUAL(0, seqs[0]);
+    TEST_ASSERT_EQUAL(2, seqs[1]); // seq 1 was the dropped frame
+    TEST_ASSERT_EQUAL(1, decoder.totals().lost);
+    TEST_ASSERT_EQUAL(0, decoder.totals().bad);
+}
+
+// The worst case bound holds for incompressible data of every length around the COBS group size
+static void test_encoded_length_bound()
+{
+    static SampleBlock block;
+    for (uint16_t len = 1; len <= 600; len++)
+    {
+        BufferOutput out;
+        out.room = FrameStream::max_encoded_len(len * sizeof(sample_t));
+        FrameStream stream(out);
+        stream.set_enabled(true);
+        block.reset();
+        for (uint16_t i = 0; i < len; i++)
+        {
+            block.samples[i] = 0x0101 + i % 0xFE; // no zero byte anywhere in the samples
+        }
+        block.len = len;
+        TEST_ASSERT_EQUAL(0, stream.write_block(block));
+        TEST_ASSERT_LESS_OR_EQUAL(out.room, out.len);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_check_value);
+    RUN_TEST(test_pty_loopback);
+    RUN_TEST(test_full_output_drops_and_counts);
+    RUN_TEST(test_encoded_length_bound);
+    return UNITY_END();
+}
@@ -0,0 +1,61 @@
+/*
+Host tests for IsrHistogram: bucketing and overflow, min/max, and a reset that reads as empty straight
+away while the writer only clears the counters on its next record().
+*/
+
+#include <unity.h>
+#include "isr_histogram.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_buckets_and_overflow()
+{
+    IsrHistogram<4, 8> hist; // 16 cycle buckets, the 8th collects everything from 112 up
+    hist.record(0);
+    hist.record(15);
+    hist.record(16);
+    hist.record(111);
+    hist.record(112);
+    hist.record(100000);
+    TEST_ASSERT_EQUAL(6, hist.count());
+    TEST_ASSERT_EQUAL(2, hist.bucket(0));
+    TEST_ASSERT_EQUAL(1, hist.bucket(1));
+    TEST_ASSERT_EQUAL(1, hist.bucket(6));
+    TEST_ASSERT_EQUAL(2, hist.bucket(7));
+    TEST_ASSERT_EQUAL(0, hist.min());
+    TEST_ASSERT_EQUAL(100000, hist.max());
+}
+
+static void test_reset_reads_empty_at_once()
+{
+    IsrHistogram<4, 8> hist;
+    hist.record(20);
+    hist.record(40);
+    hist.reset();
+
+    // No record() since the reset, the counters are still there but must not be reported
+    TEST_ASSERT_EQUAL(0, hist.count());
+    for (size_t i = 0; i < hist.BUCKET_CNT; i++)
+    {
+        TEST_ASSERT_EQUAL(0, hist.bucket(i));
+    }
+    TEST_ASSERT_EQUAL(UINT32_MAX, hist.min());
+    TEST_ASSERT_EQUAL(0, hist.max());
+
+    // The writer's next record() starts from zero
+    hist.record(50);
+    TEST_ASSERT_EQUAL(1, hist.count());
+    TEST_ASSERT_EQUAL(0, hist.bucket(1));
+    TEST_ASSERT_EQUAL(1, hist.bucket(3));
+    TEST_ASSERT_EQUAL(50, hist.min());
+    TEST_ASSERT_EQUAL(50, hist.max());
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_buckets_and_overflow);
+    RUN_TEST(test_reset_reads_empty_at_once);
+    return UNITY_END();
+}
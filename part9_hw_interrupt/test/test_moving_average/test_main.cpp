@@ -0,0 +1,177 @@
+/*
+Host tests for MovingAverage against a brute-force sum over the last len frames.
+
+Sums must match exactly at the end of every block, whatever the window length, channel count and block
+size, while the window fills and long after (the running sums never drift). A layout or filter offset
+change restarts the window, a length that does not fit is clamped, and the longest window stays exact at
+full scale.
+*/
+
+#include <stdio.h>
+#include <unity.h>
+#include "moving_average.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const size_t CAPACITY = 4096;
+static const uint32_t FRAMES = 20000;
+static const uint8_t MAX_CH = 4;
+
+static sample_t stream[FRAMES * MAX_CH];
+
+static void make_stream()
+{
+    uint32_t rng = 3;
+    for (size_t i = 0; i < FRAMES * MAX_CH; i++)
+    {
+        rng = rng * 1664525u + 1013904223u;
+        stream[i] = rng >> 20; // 12-bit
+    }
+}
+
+// Copy frames [first, first + frames) of the stream, laid out for channels, into block
+static void fill_block(SampleBlock& block, uint32_t first, uint16_t frames, uint8_t channels, uint8_t frac_bits)
+{
+    block.reset();
+    block.channels = channels;
+    block.frac_bits = frac_bits;
+    for (uint32_t i = 0; i < (uint32_t)frames * channels; i++)
+    {
+        block.samples[i] = stream[first * channels + i];
+    }
+    block.len = frames * channels;
+}
+
+// Sum of channel c over the last len frames before end
+static uint32_t brute_sum(uint32_t end, uint32_t len, uint8_t channels, uint8_t c)
+{
+    uint32_t sum = 0;
+    for (uint32_t f = end > len ? end - len : 0; f < end; f++)
+    {
+        sum += stream[f * channels + c];
+    }
+    return sum;
+}
+
+static void test_sums_match_brute_force()
+{
+    static SampleBlock block;
+    const uint32_t lens[] = {1, 10, 333, 1024};
+    const uint8_t channel_counts[] = {1, 3, 4};
+    const uint16_t block_frames[] = {1, 7, 256};
+    for (uint32_t len : lens)
+    {
+        for (uint8_t channels : channel_counts)
+        {
+            for (uint16_t frames : block_frames)
+            {
+                MovingAverage<CAPACITY> avg(len); // 8KB, fine on a host stack
+                uint32_t end = 0;
+                uint32_t errors = 0;
+                while (end + frames <= FRAMES && end < 3 * len + 600)
+                {
+                    fill_block(block, end, frames, channels, 0);
+                    avg.push_block(block);
+                    end += frames;
+                    for (uint8_t c = 0; c < channels; c++)
+                    {
+                        errors += avg.sum(c) != brute_sum(end, len, channels, c);
+                    }
+                }
+                char msg[64];
+                snprintf(msg, sizeof(msg), "len %u, %u channels, blocks of %u", (unsigned)len, channels, frames);
+                TEST_ASSERT_EQUAL_MESSAGE(0, errors, msg);
+                TEST_ASSERT_EQUAL_MESSAGE(end < len ? end : len, avg.count(), msg);
+            }
+        }
+    }
+}
+
+static void test_no_drift_over_a_long_run()
+{
+    static MovingAverage<CAPACITY> avg(1000);
+    static SampleBlock block;
+    for (uint32_t round = 0; round < 100; round++)
+    {
+        for (uint32_t end = 0; end < FRAMES; end += 250)
+        {
+            fill_block(block, end, 250, 2, 0);
+            avg.push_block(block);
+        }
+    }
+    // 2M frames later the sums are still exact
+    TEST_ASSERT_EQUAL(brute_sum(FRAMES, 1000, 2, 0), avg.sum(0));
+    TEST_ASSERT_EQUAL(brute_sum(FRAMES, 1000, 2, 1), avg.sum(1));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, brute_sum(FRAMES, 1000, 2, 1) / 1000.0, avg.mean(1));
+}
+
+static void test_restarts_and_clamping()
+{
+    static MovingAverage<CAPACITY> avg(100);
+    static SampleBlock block;
+    fill_block(block, 0, 200, 1, 0);
+    avg.push_block(block);
+    TEST_ASSERT_EQUAL(100, avg.count());
+
+    // New layout: the window starts over rather than mixing channels
+    fill_block(block, 0, 50, 2, 0);
+    avg.push_block(block);
+    TEST_ASSERT_EQUAL(2, avg.channels());
+    TEST_ASSERT_EQUAL(50, avg.count());
+    TEST_ASSERT_EQUAL(brute_sum(50, 50, 2, 1), avg.sum(1));
+
+    // Decimation fraction bits change the unit of the sums, also a restart. mean() is in ADC counts.
+    fill_block(block, 0, 20, 2, 2);
+    avg.push_block(block);
+    TEST_ASSERT_EQUAL(20, avg.count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, brute_sum(20, 20, 2, 0) / 20.0 / 4, avg.mean(0));
+
+    // So does a filter offset, which mean() takes off and mean_fixed() leaves for offset_fixed()
+    fill_block(block, 0, 30, 2, 2);
+    block.offset = 2048 << 2;
+    avg.push_block(block);
+    TEST_ASSERT_EQUAL(30, avg.count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, brute_sum(30, 30, 2, 0) / 30.0 / 4 - 2048, avg.mean(0));
+    TEST_ASSERT_EQUAL(2048u << 16, avg.offset_fixed<16>());
+
+    // CAPACITY / channels frames at most, the request is kept for when it fits again
+    TEST_ASSERT_EQUAL(-1, avg.set_len(0));
+    TEST_ASSERT_EQUAL(-1, avg.set_len(CAPACITY + 1));
+    TEST_ASSERT_EQUAL(0, avg.set_len(CAPACITY));
+    fill_block(block, 0, 10, 4, 0);
+    avg.push_block(block);
+    TEST_ASSERT_EQUAL(CAPACITY / 4, avg.len());
+    TEST_ASSERT_EQUAL(CAPACITY, avg.requested_len());
+}
+
+// The longest window of full-scale 16-bit samples still fits the 32-bit sums
+static void test_full_scale_longest_window()
+{
+    static MovingAverage<65536> avg(65536);
+    static SampleBlock block;
+    block.reset();
+    for (uint16_t i = 0; i < SAMPLE_BLOCK_MAX; i++)
+    {
+        block.samples[i] = UINT16_MAX;
+    }
+    block.len = SAMPLE_BLOCK_MAX;
+    for (uint32_t f = 0; f < 2 * 65536; f += SAMPLE_BLOCK_MAX)
+    {
+        avg.push_block(block);
+    }
+    TEST_ASSERT_EQUAL(65536, avg.count());
+    TEST_ASSERT_EQUAL(65536u * UINT16_MAX, avg.sum(0));
+    TEST_ASSERT_EQUAL((uint32_t)UINT16_MAX << 16, avg.mean_fixed<16>(0));
+}
+
+int main(int argc, char** argv)
+{
+    make_stream();
+    UNITY_BEGIN();
+    RUN_TEST(test_sums_match_brute_force);
+    RUN_TEST(test_no_drift_over_a_long_run);
+    RUN_TEST(test_restarts_and_clamping);
+    RUN_TEST(test_full_scale_longest_window);
+    return UNITY_END();
+}
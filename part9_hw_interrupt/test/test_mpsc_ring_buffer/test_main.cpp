@@ -0,0 +1,257 @@
+/*
+Host tests for MpscRingBuffer: full vs empty, and several producer threads feeding one consumer. Every
+item carries its producer and a per-producer sequence number; the consumer checks that each producer's
+items arrive in order and that every item arrives exactly once.
+
+A linearizability-style check then records every push (accepted or refused) and pop with invocation and
+response times from one shared clock, and checks the history against a FIFO queue of CAPACITY items whose
+pushes take effect somewhere between their invocation and response:
+- the items popped are exactly the accepted ones, each once, and none is popped before its push began;
+- real-time order across producers: an item whose push had returned before another push began is popped
+  first;
+- every refusal is possible: at some point during the refused push, the pushes that may already have
+  happened minus the pops that must have happened reach CAPACITY.
+A pop reporting empty is not checked. It may do so while an earlier reserved item is still being written
+(see mpsc_ring_buffer.h), which a strict queue would not.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unity.h>
+#include "mpsc_ring_buffer.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct Item
+{
+    uint32_t producer;
+    uint32_t seq;
+};
+
+static void test_empty_and_full()
+{
+    MpscRingBuffer<uint32_t, 4> rb;
+    uint32_t v;
+    TEST_ASSERT_TRUE(rb.empty());
+    TEST_ASSERT_EQUAL(-1, rb.pop(&v));
+    for (uint32_t lap = 0; lap < 3; lap++)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            TEST_ASSERT_EQUAL(0, rb.push(lap * 4 + i));
+        }
+        TEST_ASSERT_EQUAL(4, rb.size());
+        TEST_ASSERT_EQUAL(-1, rb.push(99));
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            TEST_ASSERT_EQUAL(0, rb.pop(&v));
+            TEST_ASSERT_EQUAL(lap * 4 + i, v);
+        }
+        TEST_ASSERT_TRUE(rb.empty());
+    }
+    TEST_ASSERT_EQUAL(3, rb.stats().overruns);
+    TEST_ASSERT_EQUAL(4, rb.stats().high_water);
+}
+
+static void test_producers_fifo_exactly_once()
+{
+    static const uint32_t PRODUCERS = 4;
+    static const uint32_t ITEMS = 200000; // per producer
+    static MpscRingBuffer<Item, 64> rb;
+    std::atomic<uint32_t> finished{0};
+
+    std::thread producers[PRODUCERS];
+    for (uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        producers[p] = std::thread([p, &finished]() {
+            uint32_t seq = 0;
+            while (seq < ITEMS)
+            {
+                // A full queue refuses the item, retry it so that every item is delivered once
+                if (rb.push(Item{p, seq}) == 0)
+                {
+                    seq++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+            finished++;
+        });
+    }
+
+    uint32_t next[PRODUCERS] = {};
+    uint32_t out_of_order = 0;
+    uint32_t received = 0;
+    Item item;
+    while (finished.load() < PRODUCERS || !rb.empty())
+    {
+        if (rb.pop(&item) != 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        TEST_ASSERT_LESS_OR_EQUAL(PRODUCERS - 1, item.producer);
+        // Exactly the next one expected: a lower seq is a duplicate, a higher one skipped an item
+        if (item.seq != next[item.producer])
+        {
+            out_of_order++;
+        }
+        next[item.producer] = item.seq + 1;
+        received++;
+    }
+    for (std::thread& t : producers)
+    {
+        t.join();
+    }
+
+    TEST_ASSERT_EQUAL(0, out_of_order);
+    TEST_ASSERT_EQUAL(PRODUCERS * ITEMS, received);
+    for (uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        TEST_ASSERT_EQUAL(ITEMS, next[p]);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(64, rb.stats().high_water);
+}
+
+// One push or pop, times from the shared clock
+struct Op
+{
+    uint64_t inv;
+    uint64_t resp;
+    bool ok;
+};
+
+static void test_history_is_linearizable()
+{
+    static const uint32_t PRODUCERS = 4;
+    static const uint32_t ATTEMPTS = 50000; // per producer, accepted or not
+    static const size_t N = 8; // small, so the queue is often full
+    static MpscRingBuffer<Item, N> rb;
+    static std::atomic<uint64_t> clock{0};
+    std::atomic<uint32_t> finished{0};
+
+    // Producers push every attempt once, a refused item is not retried but the producer backs off
+    static std::vector<Op> pushes[PRODUCERS];
+    std::thread producers[PRODUCERS];
+    for (uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        pushes[p].resize(ATTEMPTS);
+        producers[p] = std::thread([p, &finished]() {
+            for (uint32_t seq = 0; seq < ATTEMPTS; seq++)
+            {
+                Op& op = pushes[p][seq];
+                op.inv = clock.fetch_add(1);
+                op.ok = rb.push(Item{p, seq}) == 0;
+                op.resp = clock.fetch_add(1);
+                if (!op.ok)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            finished++;
+        });
+    }
+
+    std::vector<Item> popped;
+    std::vector<Op> pops;
+    popped.reserve(PRODUCERS * ATTEMPTS);
+    pops.reserve(PRODUCERS * ATTEMPTS);
+    Item item;
+    while (finished.load() < PRODUCERS || !rb.empty())
+    {
+        Op op;
+        op.inv = clock.fetch_add(1);
+        op.ok = rb.pop(&item) == 0;
+        op.resp = clock.fetch_add(1);
+        if (!op.ok)
+        {
+            std::this_thread::yield();
+        }
+        if (op.ok)
+        {
+            popped.push_back(item);
+            pops.push_back(op);
+        }
+    }
+    for (std::thread& t : producers)
+    {
+        t.join();
+    }
+
+    // Exactly the accepted items, each once, in push order per producer, never before their push began.
+    // Real time: no item may come out after one whose push only began once its own push had returned,
+    // i.e. the latest push invocation among the items popped so far must not follow this push's response.
+    uint32_t accepted = 0, refused = 0;
+    uint32_t next[PRODUCERS] = {};
+    uint32_t errors = 0;
+    uint64_t latest_inv = 0;
+    for (size_t i = 0; i < popped.size(); i++)
+    {
+        const Item& it = popped[i];
+        TEST_ASSERT_LESS_OR_EQUAL(PRODUCERS - 1, it.producer);
+        TEST_ASSERT_LESS_OR_EQUAL(ATTEMPTS - 1, it.seq);
+        const Op& push = pushes[it.producer][it.seq];
+        errors += !push.ok || it.seq < next[it.producer] || pops[i].resp < push.inv || latest_inv > push.resp;
+        next[it.producer] = it.seq + 1;
+        latest_inv = std::max(latest_inv, push.inv);
+    }
+    std::vector<uint64_t> accepted_inv;
+    for (uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        for (const Op& op : pushes[p])
+        {
+            if (op.ok)
+            {
+                accepted++;
+                accepted_inv.push_back(op.inv);
+            }
+            else
+            {
+                refused++;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(0, errors);
+    TEST_ASSERT_EQUAL(accepted, popped.size());
+    TEST_ASSERT_EQUAL(refused, rb.stats().overruns);
+    TEST_ASSERT_GREATER_THAN(0, refused); // the full case was exercised
+
+    // A refusal needs a full queue at some point in [inv, resp]: at most the accepted pushes begun before
+    // resp, minus at least the pops that had returned before inv
+    std::sort(accepted_inv.begin(), accepted_inv.end());
+    std::vector<uint64_t> pop_resp;
+    for (const Op& op : pops)
+    {
+        pop_resp.push_back(op.resp); // already in order, there is one consumer
+    }
+    uint32_t impossible = 0;
+    for (uint32_t p = 0; p < PRODUCERS; p++)
+    {
+        for (const Op& op : pushes[p])
+        {
+            if (op.ok)
+            {
+                continue;
+            }
+            const size_t pushed = std::lower_bound(accepted_inv.begin(), accepted_inv.end(), op.resp) -
+                accepted_inv.begin();
+            const size_t taken = std::lower_bound(pop_resp.begin(), pop_resp.end(), op.inv) - pop_resp.begin();
+            impossible += pushed - taken < N;
+        }
+    }
+    TEST_ASSERT_EQUAL(0, impossible);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_and_full);
+    RUN_TEST(test_producers_fifo_exactly_once);
+    RUN_TEST(test_history_is_linearizable);
+    return UNITY_END();
+}
@@ -0,0 +1,481 @@
+/*
+Host harness for the acquisition pipeline: SimulatedSource -> Acquisition (event detector, decimation,
+block packing) -> consumer, with the FreeRTOS notifications replaced by HostNotifier.
+
+The single-threaded tests pump the source (or call on_frames() directly) and drain the blocks in
+between, checking block contents, timestamps and jitter, decimation (also across a channel count
+change), events, runtime window and channel layout changes, and that a call publishing several blocks
+notifies once. The threaded test runs the source and the consumer on their own threads like the
+firmware's tasks, checks that the blocks that get through are intact and in order, and prints the
+throughput so changes to the downstream stages can be compared.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <unity.h>
+#include "acquisition.h"
+#include "sim_source.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Stands in for a task notification: bits accumulate until the waiting thread takes them
+class HostNotifier : public Notifier
+{
+public:
+    void notify(uint32_t bits) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            bits_ |= bits;
+            count_++;
+        }
+        cond_.notify_one();
+    }
+
+    // Take and clear the bits, waiting up to timeout_ms for any. 0 on timeout.
+    uint32_t wait(uint32_t timeout_ms)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]() { return bits_ != 0; });
+        const uint32_t bits = bits_;
+        bits_ = 0;
+        return bits;
+    }
+
+    uint32_t count()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    uint32_t bits_ = 0;
+    uint32_t count_ = 0;
+};
+
+static const uint32_t RATE_HZ = 1000; // 1 ms period, so frame f of the run is at f * 1000 us
+
+// Two channels, ch1 = 4000 - ch0
+static sample_t recording[2 * 100];
+
+static void fill_recording()
+{
+    for (size_t f = 0; f < 100; f++)
+    {
+        recording[2 * f] = 100 + 10 * f;
+        recording[2 * f + 1] = 4000 - recording[2 * f];
+    }
+}
+
+static void test_blocks_carry_the_frames()
+{
+    fill_recording();
+    static Acquisition acq;
+    HostNotifier notifier;
+    SimulatedSource src(recording, 100, 2);
+    acq.begin(&notifier);
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(16));
+    TEST_ASSERT_TRUE(src.begin(&acq, RATE_HZ));
+
+    uint32_t frame = 0;
+    for (int round = 0; round < 20; round++)
+    {
+        src.pump(16); // one window per round, so the consumer never falls behind
+        TEST_ASSERT_NOT_EQUAL(0, notifier.wait(0));
+        while (acq.ready_count() > 0)
+        {
+            SampleBlock* block = acq.acquire();
+            TEST_ASSERT_NOT_NULL(block);
+            TEST_ASSERT_EQUAL(2, block->channels);
+            TEST_ASSERT_EQUAL(16, block->frames());
+            TEST_ASSERT_EQUAL(0, block->frac_bits);
+            TEST_ASSERT_EQUAL(1000000, block->period_ns);
+            TEST_ASSERT_EQUAL((uint64_t)frame * 1000, block->t0_us);
+            for (uint16_t i = 0; i < block->frames(); i++, frame++)
+            {
+                TEST_ASSERT_EQUAL(recording[2 * (frame % 100)], block->samples[2 * i]);
+                TEST_ASSERT_EQUAL(recording[2 * (frame % 100) + 1], block->samples[2 * i + 1]);
+                TEST_ASSERT_EQUAL(0, block->jitter_us[i]); // virtual clock, exactly on the grid
+            }
+            acq.release(block);
+        }
+    }
+    TEST_ASSERT_EQUAL(320, frame);
+    TEST_ASSERT_EQUAL(0, acq.stats().overruns);
+    TEST_ASSERT_EQUAL(20, notifier.count());
+}
+
+// Frames straight into on_frames(), sample c of frame f = f * channels + c, frame f at t0_us + f ms
+static void feed(Acquisition& acq, uint32_t first, uint32_t frames, uint8_t channels, uint64_t t0_us)
+{
+    static sample_t buf[SAMPLE_BLOCK_MAX * SAMPLE_MAX_CHANNELS];
+    for (uint32_t i = 0; i < frames * channels; i++)
+    {
+        buf[i] = first * channels + i;
+    }
+    acq.on_frames(buf, frames, channels, t0_us, 1000000);
+}
+
+// Take the oldest ready block, check its length and first sample, give it back
+static void expect_block(Acquisition& acq, uint16_t frames, sample_t first_sample)
+{
+    SampleBlock* block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(frames, block->frames());
+    TEST_ASSERT_EQUAL(first_sample, block->samples[0]);
+    acq.release(block);
+}
+
+static void test_window_len_changes_at_runtime()
+{
+    static Acquisition acq;
+    HostNotifier notifier;
+    acq.begin(&notifier);
+    TEST_ASSERT_EQUAL(-1, acq.set_window_len(0));
+    TEST_ASSERT_EQUAL(-1, acq.set_window_len(SAMPLE_BLOCK_MAX + 1));
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(16));
+
+    // Shorter while 10 frames are in: the block being filled is published with the next frame, as is
+    feed(acq, 0, 10, 1, 0);
+    TEST_ASSERT_EQUAL(0, acq.ready_count());
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(8));
+    TEST_ASSERT_EQUAL(8, acq.window_len());
+    feed(acq, 10, 9, 1, 10000);
+    TEST_ASSERT_EQUAL(2, acq.ready_count());
+    expect_block(acq, 11, 0);
+    expect_block(acq, 8, 11);
+
+    // Longer: the block being filled just keeps going
+    feed(acq, 19, 5, 1, 19000);
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(SAMPLE_BLOCK_MAX));
+    feed(acq, 24, SAMPLE_BLOCK_MAX - 5, 1, 24000);
+    TEST_ASSERT_EQUAL(1, acq.ready_count());
+    expect_block(acq, SAMPLE_BLOCK_MAX, 19);
+    TEST_ASSERT_EQUAL(0, acq.stats().overruns);
+}
+
+static void test_channel_layout()
+{
+    static Acquisition acq;
+    HostNotifier notifier;
+    acq.begin(&notifier);
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(SAMPLE_BLOCK_MAX));
+
+    // 3 channels: the block is full at 341 frames (1023 samples), short of the window
+    feed(acq, 0, 400, 3, 0);
+    TEST_ASSERT_EQUAL(1, acq.ready_count());
+    SampleBlock* block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(3, block->channels);
+    TEST_ASSERT_EQUAL(SAMPLE_BLOCK_MAX / 3, block->frames());
+    for (uint16_t i = 0; i < block->len; i++)
+    {
+        TEST_ASSERT_EQUAL(i, block->samples[i]); // interleaved frame by frame
+    }
+    acq.release(block);
+
+    // Down to 2 channels: the 59 frames of 3 are handed over first, never mixed with the new layout
+    feed(acq, 0, 10, 2, 400000);
+    TEST_ASSERT_EQUAL(1, acq.ready_count());
+    block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(3, block->channels);
+    TEST_ASSERT_EQUAL(400 - SAMPLE_BLOCK_MAX / 3, block->frames());
+    TEST_ASSERT_EQUAL(SAMPLE_BLOCK_MAX / 3 * 3, block->samples[0]);
+    acq.release(block);
+
+    feed(acq, 10, SAMPLE_BLOCK_MAX / 2 - 10, 2, 410000);
+    TEST_ASSERT_EQUAL(1, acq.ready_count());
+    block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(2, block->channels);
+    TEST_ASSERT_EQUAL(SAMPLE_BLOCK_MAX / 2, block->frames());
+    TEST_ASSERT_EQUAL(400000, block->t0_us);
+    TEST_ASSERT_EQUAL(SAMPLE_BLOCK_MAX - 1, block->samples[SAMPLE_BLOCK_MAX - 1]);
+    acq.release(block);
+}
+
+static void test_jitter_and_time_base_changes()
+{
+    static Acquisition acq;
+    HostNotifier notifier;
+    acq.begin(&notifier);
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(16));
+
+    // Calls a little late and a little early: the frames keep their grid, the offsets go into jitter_us
+    feed(acq, 0, 4, 1, 0);
+    feed(acq, 4, 4, 1, 4003);
+    feed(acq, 8, 4, 1, 7998);
+    // 40 ms off the grid is more than jitter_us holds: the 12 frames so far go out early
+    feed(acq, 12, 4, 1, 52000);
+    TEST_ASSERT_EQUAL(1, acq.ready_count());
+    SampleBlock* block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(12, block->frames());
+    TEST_ASSERT_EQUAL(0, block->t0_us);
+    const int16_t jitter[12] = {0, 0, 0, 0, 3, 3, 3, 3, -2, -2, -2, -2};
+    for (uint16_t i = 0; i < 12; i++)
+    {
+        TEST_ASSERT_EQUAL(jitter[i], block->jitter_us[i]);
+        TEST_ASSERT_EQUAL(i * 1000, block->grid_us(i));
+        TEST_ASSERT_EQUAL(i * 1000 + jitter[i], block->timestamp_us(i));
+    }
+    acq.release(block);
+
+    // A new period is a new time base, also handed over first
+    const sample_t frames[4] = {};
+    acq.on_frames(frames, 4, 1, 56000, 500000);
+    TEST_ASSERT_EQUAL(1, acq.ready_count());
+    block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(4, block->frames());
+    TEST_ASSERT_EQUAL(52000, block->t0_us);
+    TEST_ASSERT_EQUAL(1000000, block->period_ns);
+    TEST_ASSERT_EQUAL(55000, block->timestamp_us(3));
+    acq.release(block);
+
+    acq.on_frames(frames, 12, 1, 58000, 500000);
+    block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(16, block->frames());
+    TEST_ASSERT_EQUAL(56000, block->t0_us);
+    TEST_ASSERT_EQUAL(500000, block->period_ns);
+    TEST_ASSERT_EQUAL(63500, block->timestamp_us(15));
+    acq.release(block);
+}
+
+static void test_decimation_scales_and_slows_down()
+{
+    static Acquisition acq;
+    HostNotifier notifier;
+    SimulatedSource src(SimWaveform{1000.f, 0.f, 1.f, 0.f}); // constant 1000 counts
+    acq.begin(&notifier);
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(8));
+    TEST_ASSERT_EQUAL(0, acq.set_decimation(4, 2));
+    TEST_ASSERT_TRUE(src.begin(&acq, RATE_HZ));
+
+    src.pump(4 * 8 * 2);
+    TEST_ASSERT_EQUAL(2, acq.ready_count()); // the third block is the one being filled
+    SampleBlock* block = acq.acquire();
+    TEST_ASSERT_EQUAL(8, block->frames());
+    TEST_ASSERT_EQUAL(1, block->frac_bits); // half a bit per doubling of the ratio
+    TEST_ASSERT_EQUAL(4000000, block->period_ns);
+    TEST_ASSERT_EQUAL(3000, block->t0_us); // timestamp of the last input frame in the first output
+    // The first output of an order 2 CIC is still settling, the rest sit at DC gain
+    for (uint16_t i = 1; i < block->frames(); i++)
+    {
+        TEST_ASSERT_EQUAL(1000 << 1, block->samples[i]);
+    }
+    acq.release(block);
+}
+
+// Ramp input, so an output built from stale or mismatched decimator state shows up as a wrong value
+static void test_decimation_restarts_on_channel_change()
+{
+    static Acquisition acq;
+    HostNotifier notifier;
+    acq.begin(&notifier);
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(2));
+    TEST_ASSERT_EQUAL(0, acq.set_decimation(4, 1)); // boxcar: every output is exact, no settling
+
+    // 6 frames of 2 channels: one output, then the decimators are half way through the next one
+    feed(acq, 0, 6, 2, 0);
+    TEST_ASSERT_EQUAL(0, acq.ready_count());
+
+    // 3 channels from frame 6 on: every channel starts over at frame 6, outputs at frames 9 and 13
+    feed(acq, 6, 8, 3, 6000);
+    TEST_ASSERT_EQUAL(2, acq.ready_count());
+    SampleBlock* block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(2, block->channels);
+    TEST_ASSERT_EQUAL(1, block->frames());
+    TEST_ASSERT_EQUAL(6, block->samples[0]); // (0 + 2 + 4 + 6) / 4 << 1
+    TEST_ASSERT_EQUAL(8, block->samples[1]);
+    acq.release(block);
+
+    block = acq.acquire();
+    TEST_ASSERT_NOT_NULL(block);
+    TEST_ASSERT_EQUAL(3, block->channels);
+    TEST_ASSERT_EQUAL(2, block->frames());
+    TEST_ASSERT_EQUAL(1, block->frac_bits);
+    TEST_ASSERT_EQUAL(9000, block->t0_us);
+    for (uint16_t k = 0; k < 2; k++)
+    {
+        // Sample c of frame f is 3 * f + c: the mean over frames f0..f0+3 is 3 * f0 + 4.5 + c, kept with 1 bit
+        const uint32_t f0 = 6 + 4 * k;
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            TEST_ASSERT_EQUAL(6 * f0 + 9 + 2 * c, block->samples[3 * k + c]);
+        }
+    }
+    acq.release(block);
+}
+
+static void test_events_fire_on_the_crossing_frame()
+{
+    fill_recording();
+    static Acquisition acq;
+    HostNotifier consumer;
+    HostNotifier handler;
+    SimulatedSource src(recording, 100, 2);
+    acq.begin(&consumer);
+    acq.detector().begin(&handler);
+    TEST_ASSERT_EQUAL(0, acq.detector().set_rule(0, EventDetector::Rule{500, 300, 0}));
+    TEST_ASSERT_EQUAL(0, acq.detector().set_rule(1, EventDetector::Rule{0, 0, 100}));
+    TEST_ASSERT_TRUE(src.begin(&acq, RATE_HZ));
+
+    // ch0 ramps 100, 110, .. 1090, then jumps back to 100 at frame 100
+    src.pump(120);
+    TEST_ASSERT_NOT_EQUAL(0, handler.wait(0));
+
+    DetectorEvent ev;
+    uint32_t rising = 0;
+    uint32_t falling = 0;
+    uint32_t slope = 0;
+    while (acq.detector().pop(&ev) == 0)
+    {
+        if (ev.kind == EventKind::Rising)
+        {
+            rising++;
+            TEST_ASSERT_EQUAL(0, ev.channel);
+            TEST_ASSERT_EQUAL(500, ev.value);
+            TEST_ASSERT_EQUAL(40000, ev.timestamp_us); // frame 40
+        }
+        else if (ev.kind == EventKind::Falling)
+        {
+            falling++;
+            TEST_ASSERT_EQUAL(100, ev.value);
+            TEST_ASSERT_EQUAL(100000, ev.timestamp_us); // the wrap back at frame 100
+        }
+        else
+        {
+            // ch1 moves 10 per frame, under the limit, except for the jump at the wrap
+            slope++;
+            TEST_ASSERT_EQUAL(1, ev.channel);
+            TEST_ASSERT_EQUAL(3900, ev.value);
+            TEST_ASSERT_EQUAL(100000, ev.timestamp_us);
+        }
+    }
+    TEST_ASSERT_EQUAL(1, rising);
+    TEST_ASSERT_EQUAL(1, falling);
+    TEST_ASSERT_EQUAL(1, slope);
+    TEST_ASSERT_EQUAL(0, acq.detector().dropped());
+}
+
+static void test_one_notification_per_call()
+{
+    fill_recording();
+    static Acquisition acq;
+    HostNotifier notifier;
+    SimulatedSource src(recording, 100, 2);
+    acq.begin(&notifier);
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(16));
+    TEST_ASSERT_TRUE(src.begin(&acq, RATE_HZ));
+
+    // Two windows in one on_frames() call: one wake-up carrying both block indices
+    src.pump(32);
+    TEST_ASSERT_EQUAL(1, notifier.count());
+    TEST_ASSERT_EQUAL(2, __builtin_popcount(notifier.wait(0)));
+    TEST_ASSERT_EQUAL(2, acq.ready_count());
+    for (uint64_t t0_us : {0, 16000})
+    {
+        SampleBlock* block = acq.acquire();
+        TEST_ASSERT_NOT_NULL(block);
+        TEST_ASSERT_EQUAL(t0_us, block->t0_us);
+        acq.release(block);
+    }
+
+    // Half a window publishes nothing and wakes nobody, the other half one block
+    src.pump(8);
+    TEST_ASSERT_EQUAL(1, notifier.count());
+    src.pump(8);
+    TEST_ASSERT_EQUAL(2, notifier.count());
+    TEST_ASSERT_EQUAL(1, __builtin_popcount(notifier.wait(0)));
+    TEST_ASSERT_EQUAL(1, acq.ready_count());
+    TEST_ASSERT_EQUAL(0, acq.stats().overruns);
+}
+
+// Source and consumer on their own threads, as fast as the host goes
+static void test_threaded_throughput()
+{
+    static const uint32_t FRAMES = 256 * 8000;
+    static Acquisition acq;
+    HostNotifier notifier;
+    SimulatedSource src(SimWaveform{2048.f, 1000.f, 50.f, 20.f});
+    const int four[4] = {};
+    TEST_ASSERT_TRUE(src.set_pins(four, 4));
+    acq.begin(&notifier);
+    TEST_ASSERT_EQUAL(0, acq.set_window_len(256));
+    TEST_ASSERT_TRUE(src.begin(&acq, 20000));
+    std::atomic<bool> done{false};
+
+    const auto t0 = std::chrono::steady_clock::now();
+    std::thread producer([&]() {
+        for (uint32_t f = 0; f < FRAMES; f += 256)
+        {
+            src.pump(256);
+            std::this_thread::yield();
+        }
+        done.store(true);
+    });
+
+    uint32_t blocks = 0;
+    uint32_t errors = 0;
+    uint64_t last_t0 = 0;
+    uint64_t sum = 0;
+    while (!done.load() || acq.ready_count() > 0)
+    {
+        notifier.wait(10);
+        while (acq.ready_count() > 0)
+        {
+            SampleBlock* block = acq.acquire();
+            if (block == NULL)
+            {
+                break; // reclaimed by the producer (OverwriteOldest)
+            }
+            if (block->channels != 4 || block->frames() != 256 || (blocks > 0 && block->t0_us <= last_t0))
+            {
+                errors++;
+            }
+            last_t0 = block->t0_us;
+            for (uint16_t i = 0; i < block->len; i++)
+            {
+                sum += block->samples[i];
+            }
+            blocks++;
+            acq.release(block);
+        }
+    }
+    producer.join();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    TEST_ASSERT_EQUAL(0, errors);
+    TEST_ASSERT_EQUAL(FRAMES / 256, blocks + acq.stats().overruns);
+    TEST_ASSERT_GREATER_THAN(0, sum);
+    char line[128];
+    snprintf(line, sizeof(line), "%u blocks consumed, %u overruns, %.2f Mframes/s (4 channels)",
+        (unsigned)blocks, (unsigned)acq.stats().overruns, FRAMES / secs / 1e6);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_blocks_carry_the_frames);
+    RUN_TEST(test_window_len_changes_at_runtime);
+    RUN_TEST(test_channel_layout);
+    RUN_TEST(test_jitter_and_time_base_changes);
+    RUN_TEST(test_decimation_scales_and_slows_down);
+    RUN_TEST(test_decimation_restarts_on_channel_change);
+    RUN_TEST(test_events_fire_on_the_crossing_frame);
+    RUN_TEST(test_one_notification_per_call);
+    RUN_TEST(test_threaded_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+/*
+Host tests for QuantileSketch against the exact quantiles of the sorted samples.
+
+For several distributions and bucket resolutions every quantile must be within 2^-SUB_BITS (relative) of
+the sample that really has that rank, values below 2^SUB_BITS come back exact, the 16-bit extremes land in
+the first and last buckets, and after reset() the sketch reads empty at once while the writer clears the
+counters on its next add().
+*/
+
+#include <algorithm>
+#include <stdio.h>
+#include <unity.h>
+#include "quantile_sketch.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const size_t SAMPLES = 100000;
+static const float QUANTILES[] = {0.f, 0.001f, 0.1f, 0.25f, 0.5f, 0.9f, 0.99f, 0.999f, 1.f};
+
+static uint16_t values[SAMPLES];
+static uint16_t sorted[SAMPLES];
+
+enum Distribution
+{
+    UNIFORM,
+    SKEWED, // most samples small, a long tail up to full scale
+    NARROW, // a few counts of noise on a large offset, like a quiet ADC channel
+};
+
+static void make_values(Distribution dist, uint32_t seed)
+{
+    for (size_t i = 0; i < SAMPLES; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const uint16_t r = seed >> 16;
+        values[i] = dist == UNIFORM ? r : dist == SKEWED ? (uint64_t)r * r * r >> 32 : 30000 + r % 9;
+        sorted[i] = values[i];
+    }
+    std::sort(sorted, sorted + SAMPLES);
+}
+
+// Same rank rule as quantile(): nearest rank, clamped to 1..n
+static uint16_t exact_quantile(float q)
+{
+    uint32_t rank = (uint32_t)(q * SAMPLES + 0.5f);
+    rank = rank < 1 ? 1 : (rank > SAMPLES ? SAMPLES : rank);
+    return sorted[rank - 1];
+}
+
+template <uint8_t SUB_BITS>
+static void check_distribution(Distribution dist)
+{
+    static QuantileSketch<SUB_BITS> sketch;
+    sketch.reset();
+    make_values(dist, 7 + dist);
+    for (size_t i = 0; i < SAMPLES; i++)
+    {
+        sketch.add(values[i]);
+    }
+    TEST_ASSERT_EQUAL(SAMPLES, sketch.total());
+
+    for (float q : QUANTILES)
+    {
+        const uint16_t exact = exact_quantile(q);
+        const float bound = (float)exact / (1u << SUB_BITS);
+        char msg[64];
+        snprintf(msg, sizeof(msg), "SUB_BITS %u, distribution %d, q %g", SUB_BITS, (int)dist, q);
+        TEST_ASSERT_FLOAT_WITHIN_MESSAGE(bound, exact, sketch.quantile(q), msg);
+    }
+}
+
+static void test_matches_exact_quantiles()
+{
+    for (Distribution dist : {UNIFORM, SKEWED, NARROW})
+    {
+        check_distribution<2>(dist);
+        check_distribution<7>(dist);
+        check_distribution<12>(dist);
+    }
+}
+
+static void test_small_values_are_exact()
+{
+    static QuantileSketch<7> sketch;
+    for (uint16_t v = 0; v < 128; v++)
+    {
+        sketch.add(v);
+    }
+    for (uint16_t v = 0; v < 128; v++)
+    {
+        TEST_ASSERT_EQUAL(v, sketch.quantile((v + 1) / 128.f));
+    }
+}
+
+static void test_extremes()
+{
+    static QuantileSketch<7> sketch;
+    TEST_ASSERT_EQUAL(0, sketch.quantile(0.5f)); // empty
+
+    sketch.add(0);
+    sketch.add(UINT16_MAX);
+    TEST_ASSERT_EQUAL(0, sketch.quantile(0.f));
+    TEST_ASSERT_FLOAT_WITHIN(UINT16_MAX / 128.f, UINT16_MAX, sketch.quantile(1.f));
+
+    // Every value maps to a bucket at or after the previous value's: one sample of each, in order
+    sketch.reset();
+    for (uint32_t v = 0; v <= UINT16_MAX; v++)
+    {
+        sketch.add(v);
+    }
+    uint16_t last = 0;
+    for (uint32_t v = 0; v <= UINT16_MAX; v += 97)
+    {
+        const uint16_t got = sketch.quantile((v + 1) / 65536.f);
+        TEST_ASSERT_GREATER_OR_EQUAL(last, got);
+        TEST_ASSERT_FLOAT_WITHIN(v / 128.f + 1, v, got);
+        last = got;
+    }
+}
+
+static void test_reset_reads_empty_at_once()
+{
+    static QuantileSketch<7> sketch;
+    for (uint16_t i = 0; i < 1000; i++)
+    {
+        sketch.add(5000);
+    }
+    sketch.reset();
+    TEST_ASSERT_EQUAL(0, sketch.total()); // the writer has not run yet, readers see an empty sketch
+    TEST_ASSERT_EQUAL(0, sketch.quantile(0.5f));
+
+    sketch.add(40);
+    TEST_ASSERT_EQUAL(1, sketch.total());
+    TEST_ASSERT_EQUAL(40, sketch.quantile(0.5f));
+    sketch.add(41);
+    TEST_ASSERT_EQUAL(2, sketch.total()); // a reset is only done once
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_exact_quantiles);
+    RUN_TEST(test_small_values_are_exact);
+    RUN_TEST(test_extremes);
+    RUN_TEST(test_reset_reads_empty_at_once);
+    return UNITY_END();
+}
@@ -0,0 +1,231 @@
+/*
+Host tests for RingBuffer: full vs empty with free-running counters, wrap-around of the slot index, and
+two-thread stress runs checking that every item arrives once and in order.
+*/
+
+#include <thread>
+#include <unity.h>
+#include "ring_buffer.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_empty_and_full_are_distinct()
+{
+    RingBuffer<uint32_t, 4> rb;
+    uint32_t v;
+    TEST_ASSERT_TRUE(rb.empty());
+    TEST_ASSERT_EQUAL(-1, rb.pop(&v));
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL(0, rb.push(i));
+    }
+    // All N slots are usable: no slot is sacrificed to tell full from empty
+    TEST_ASSERT_TRUE(rb.full());
+    TEST_ASSERT_FALSE(rb.empty());
+    TEST_ASSERT_EQUAL(4, rb.size());
+    TEST_ASSERT_EQUAL(-1, rb.push(99));
+    TEST_ASSERT_EQUAL(1, rb.stats().overruns);
+
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL(0, rb.pop(&v));
+        TEST_ASSERT_EQUAL(i, v);
+    }
+    TEST_ASSERT_TRUE(rb.empty());
+    TEST_ASSERT_EQUAL(-1, rb.pop(&v));
+    TEST_ASSERT_EQUAL(2, rb.stats().underruns); // both reads of the empty buffer
+}
+
+static void test_fill_levels_across_wraps()
+{
+    // Walk the counters through many cycles of the slot index and check head - tail at every fill level
+    RingBuffer<uint32_t, 4> rb;
+    uint32_t next_in = 0;
+    uint32_t next_out = 0;
+    for (int round = 0; round < 1000; round++)
+    {
+        const uint32_t fill = round % 5;
+        for (uint32_t i = 0; i < fill; i++)
+        {
+            TEST_ASSERT_EQUAL(0, rb.push(next_in++));
+        }
+        TEST_ASSERT_EQUAL(fill, rb.size());
+        TEST_ASSERT_EQUAL(fill == 4, rb.full());
+        uint32_t v;
+        while (rb.pop(&v) == 0)
+        {
+            TEST_ASSERT_EQUAL(next_out++, v);
+        }
+    }
+    TEST_ASSERT_EQUAL(next_in, next_out);
+}
+
+static void test_bulk_wraps_around()
+{
+    RingBuffer<uint16_t, 8> rb;
+    uint16_t in[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint16_t out[8] = {};
+    TEST_ASSERT_EQUAL(5, rb.push_n(in, 5));
+    TEST_ASSERT_EQUAL(5, rb.pop_n(out, 5));
+    // The next 8 items start at slot 5 and wrap
+    TEST_ASSERT_EQUAL(8, rb.push_n(in, 8));
+    TEST_ASSERT_EQUAL(0, rb.push_n(in, 1));
+    RingBuffer<uint16_t, 8>::Regions r = rb.peek_contiguous(8);
+    TEST_ASSERT_EQUAL(3, r.first_len);
+    TEST_ASSERT_EQUAL(5, r.second_len);
+    TEST_ASSERT_EQUAL(8, rb.pop_n(out, 8));
+    TEST_ASSERT_EQUAL_MEMORY(in, out, sizeof(in));
+}
+
+// push_n()/pop_n() must instantiate under every policy and go item by item under OverwriteOldest
+static void test_bulk_overwrite_oldest()
+{
+    RingBuffer<uint16_t, 4, OverflowPolicy::OverwriteOldest> rb;
+    const uint16_t in[6] = {1, 2, 3, 4, 5, 6};
+    uint16_t out[6] = {};
+    TEST_ASSERT_EQUAL(6, rb.push_n(in, 6)); // accepted, the two oldest are evicted
+    TEST_ASSERT_EQUAL(2, rb.stats().overruns);
+    TEST_ASSERT_EQUAL(4, rb.pop_n(out, 6));
+    const uint16_t newest[4] = {3, 4, 5, 6};
+    TEST_ASSERT_EQUAL_MEMORY(newest, out, sizeof(newest));
+    TEST_ASSERT_EQUAL(0, rb.pop_n(out, 1));
+
+    RingBuffer<uint16_t, 4, OverflowPolicy::Backpressure> bp;
+    TEST_ASSERT_EQUAL(4, bp.push_n(in, 6));
+    TEST_ASSERT_EQUAL(1, bp.stats().stalls);
+    TEST_ASSERT_EQUAL(4, bp.pop_n(out, 6));
+    TEST_ASSERT_EQUAL_MEMORY(in, out, 4 * sizeof(uint16_t));
+}
+
+// One producer and one consumer thread, sequence numbers must come out exactly in order
+template <OverflowPolicy P>
+static void stress_in_order(bool bulk)
+{
+    static const uint32_t ITEMS = 1000000;
+    static RingBuffer<uint32_t, 64, P> rb;
+
+    std::thread producer([bulk]() {
+        uint32_t next = 0;
+        uint32_t chunk[7];
+        while (next < ITEMS)
+        {
+            if (bulk)
+            {
+                size_t n = 0;
+                while (n < 7 && next + n < ITEMS)
+                {
+                    chunk[n] = next + n;
+                    n++;
+                }
+                const size_t pushed = rb.push_n(chunk, n);
+                next += pushed;
+                if (pushed == 0)
+                {
+                    std::this_thread::yield(); // full, let the consumer run (matters on a single core)
+                }
+            }
+            else if (rb.push(next) == 0)
+            {
+                next++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    uint32_t chunk[5];
+    while (expected < ITEMS)
+    {
+        size_t n;
+        if (bulk)
+        {
+            n = rb.pop_n(chunk, 5);
+        }
+        else
+        {
+            n = rb.pop(&chunk[0]) == 0 ? 1 : 0;
+        }
+        if (n == 0)
+        {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            if (chunk[i] != expected++)
+            {
+                errors++;
+            }
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL(0, errors);
+    TEST_ASSERT_TRUE(rb.empty());
+    TEST_ASSERT_LESS_OR_EQUAL(64, rb.stats().high_water);
+}
+
+static void test_concurrent_drop_newest() { stress_in_order<OverflowPolicy::DropNewest>(false); }
+static void test_concurrent_drop_newest_bulk() { stress_in_order<OverflowPolicy::DropNewest>(true); }
+static void test_concurrent_backpressure() { stress_in_order<OverflowPolicy::Backpressure>(false); }
+
+// With OverwriteOldest items may be lost, but what arrives must still be strictly increasing
+static void test_concurrent_overwrite_oldest()
+{
+    static const uint32_t ITEMS = 1000000;
+    static RingBuffer<uint32_t, 16, OverflowPolicy::OverwriteOldest> rb;
+    std::atomic<bool> done{false};
+
+    std::thread producer([&done]() {
+        for (uint32_t i = 1; i <= ITEMS; i++)
+        {
+            rb.push(i);
+        }
+        done.store(true);
+    });
+
+    uint32_t last = 0;
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    uint32_t v;
+    while (!done.load() || !rb.empty())
+    {
+        if (rb.pop(&v) == 0)
+        {
+            if (v <= last)
+            {
+                errors++;
+            }
+            last = v;
+            received++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    TEST_ASSERT_EQUAL(0, errors);
+    TEST_ASSERT_EQUAL(ITEMS, last); // the newest item is never the one evicted
+    TEST_ASSERT_EQUAL(ITEMS, received + rb.stats().overruns);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_and_full_are_distinct);
+    RUN_TEST(test_fill_levels_across_wraps);
+    RUN_TEST(test_bulk_wraps_around);
+    RUN_TEST(test_bulk_overwrite_oldest);
+    RUN_TEST(test_concurrent_drop_newest);
+    RUN_TEST(test_concurrent_drop_newest_bulk);
+    RUN_TEST(test_concurrent_backpressure);
+    RUN_TEST(test_concurrent_overwrite_oldest);
+    return UNITY_END();
+}
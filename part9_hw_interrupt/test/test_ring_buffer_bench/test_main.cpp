@@ -0,0 +1,218 @@
+/*
+Host benchmark: cost of one push + pop through RingBuffer against the circ_bbuf_* functions it replaced.
+
+circ_bbuf is reproduced as it was (volatile struct, int indices wrapped with % max_len) except for its
+full check, which compared tail == head and so refused every push into an empty buffer; here it is the
+usual (head + 1) % max_len == tail. Both run the same pattern, 8 pushes then 8 pops, through non-inlined
+calls as the ISR and the task make them.
+
+Instructions are counted with perf_event_open() where the kernel allows it; otherwise the time per pair is
+reported instead. The figures are printed, not asserted: they depend on the host CPU and flags, and only
+the ratio carries over to the ESP32. The checksums make sure both versions moved the same data.
+*/
+
+#include <chrono>
+#include <stdio.h>
+#include <unity.h>
+#include "ring_buffer.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+// The original implementation
+typedef struct
+{
+    uint32_t* const arr;
+    int head;
+    int tail;
+    const int max_len;
+} circ_bbuf_t;
+
+#define CIRC_BBUF_DEF(x, y)              \
+    uint32_t x##_data_space[y];          \
+    static volatile circ_bbuf_t x = {    \
+        .arr = x##_data_space,           \
+        .head = 0,                       \
+        .tail = 0,                       \
+        .max_len = y                     \
+    }
+
+__attribute__((noinline)) int circ_bbuf_push(volatile circ_bbuf_t* buf, uint32_t data)
+{
+    // queue is full
+    if ((buf->head + 1) % buf->max_len == buf->tail)
+    {
+        return -1;
+    }
+
+    buf->arr[buf->head] = data;
+    buf->head = (buf->head + 1) % buf->max_len;
+    return 0;
+}
+
+__attribute__((noinline)) int circ_bbuf_pop(volatile circ_bbuf_t* buf, uint32_t* data)
+{
+    // buffer is empty
+    if (buf->tail == buf->head)
+    {
+        return -1;
+    }
+
+    *data = buf->arr[buf->tail];
+    buf->tail = (buf->tail + 1) % buf->max_len;
+    return 0;
+}
+
+static const size_t BUF_LEN = 16;
+static const uint32_t ROUNDS = 200000;
+static const uint32_t BATCH = 8;
+
+CIRC_BBUF_DEF(legacy_buf, BUF_LEN);
+static RingBuffer<uint32_t, BUF_LEN> ring_buf;
+
+__attribute__((noinline)) int ring_push(uint32_t data)
+{
+    return ring_buf.push(data);
+}
+
+__attribute__((noinline)) int ring_pop(uint32_t* data)
+{
+    return ring_buf.pop(data);
+}
+
+// Instructions retired by this thread in user space, or -1 if the counter is not available
+class InstructionCounter
+{
+public:
+    InstructionCounter()
+    {
+#if defined(__linux__)
+        struct perf_event_attr attr = {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~InstructionCounter()
+    {
+#if defined(__linux__)
+        if (fd_ >= 0)
+        {
+            close(fd_);
+        }
+#endif
+    }
+
+    bool available() const { return fd_ >= 0; }
+
+    void start()
+    {
+#if defined(__linux__)
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    int64_t stop()
+    {
+        int64_t count = -1;
+#if defined(__linux__)
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd_, &count, sizeof(count)) != sizeof(count))
+        {
+            count = -1;
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+struct Result
+{
+    double per_pair; // instructions or ns per push + pop
+    uint64_t checksum;
+};
+
+template <typename Push, typename Pop>
+static Result run(Push push, Pop pop)
+{
+    InstructionCounter counter;
+    uint64_t checksum = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    if (counter.available())
+    {
+        counter.start();
+    }
+    for (uint32_t r = 0; r < ROUNDS; r++)
+    {
+        for (uint32_t i = 0; i < BATCH; i++)
+        {
+            push(r * BATCH + i);
+        }
+        uint32_t v;
+        for (uint32_t i = 0; i < BATCH; i++)
+        {
+            if (pop(&v) == 0)
+            {
+                checksum += v;
+            }
+        }
+    }
+    const int64_t instructions = counter.available() ? counter.stop() : -1;
+    const auto t1 = std::chrono::steady_clock::now();
+
+    const double pairs = (double)ROUNDS * BATCH;
+    Result res;
+    res.checksum = checksum;
+    if (instructions >= 0)
+    {
+        res.per_pair = instructions / pairs;
+    }
+    else
+    {
+        res.per_pair = std::chrono::duration<double, std::nano>(t1 - t0).count() / pairs;
+    }
+    return res;
+}
+
+static void test_push_pop_cost()
+{
+    const bool counting = InstructionCounter().available();
+    const Result legacy = run(
+        [](uint32_t v) { return circ_bbuf_push(&legacy_buf, v); },
+        [](uint32_t* v) { return circ_bbuf_pop(&legacy_buf, v); });
+    const Result ring = run(ring_push, ring_pop);
+
+    const uint64_t n = (uint64_t)ROUNDS * BATCH;
+    TEST_ASSERT_EQUAL_UINT64(n * (n - 1) / 2, legacy.checksum);
+    TEST_ASSERT_EQUAL_UINT64(legacy.checksum, ring.checksum);
+
+    char line[128];
+    const char* unit = counting ? "instructions" : "ns (instruction counter unavailable)";
+    snprintf(line, sizeof(line), "circ_bbuf: %.1f %s per push + pop", legacy.per_pair, unit);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "RingBuffer: %.1f %s per push + pop", ring.per_pair, unit);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_push_pop_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,106 @@
+/*
+Host tests for the CPU budget check of SamplerConfig against a source whose per-frame cost is set by hand.
+
+Before anything has been measured the check uses the per-channel estimate instead of accepting any rate,
+and the measured cost is a worst case over the running config only: a new pin list or rate starts it
+over, so dropping channels (or a one-off slow frame at an old rate) does not keep the limit down.
+*/
+
+#include <unity.h>
+#include "sampler_config.h"
+
+void setUp() {}
+void tearDown() {}
+
+// At the host's assumed 240 MHz, 50% of a core is 120M cycles/s
+static const uint32_t BUDGET_CYCLES = 120000000;
+
+// Delivers nothing, measure() stands in for the backend's own timing
+class CostSource : public SampleSource
+{
+public:
+    bool begin(SampleSink* sink, uint32_t rate_hz) override
+    {
+        rate_hz_ = rate_hz;
+        reset_cost();
+        return true;
+    }
+    void end() override {}
+    bool set_rate(uint32_t rate_hz) override
+    {
+        rate_hz_ = rate_hz;
+        reset_cost();
+        return true;
+    }
+    const char* name() const override { return "cost"; }
+
+    void measure(uint32_t cycles) { record_cost(cycles, 1); }
+};
+
+static const int PINS[] = {1, 2, 3, 4};
+
+static void test_unmeasured_cost_is_an_estimate()
+{
+    static Acquisition acquisition;
+    CostSource source;
+    SamplerConfig config(source, acquisition);
+    TEST_ASSERT_TRUE(source.set_pins(PINS, 4));
+    TEST_ASSERT_TRUE(source.begin(&acquisition, 1000));
+
+    TEST_ASSERT_FALSE(source.cost_measured());
+    TEST_ASSERT_EQUAL(4 * SampleSource::DEFAULT_CYCLES_PER_CHANNEL, source.cycles_per_frame());
+    const uint32_t limit = BUDGET_CYCLES / (4 * SampleSource::DEFAULT_CYCLES_PER_CHANNEL);
+    TEST_ASSERT_EQUAL(limit, config.max_rate_hz());
+    TEST_ASSERT_EQUAL(-1, config.set_rate(limit + 1));
+    TEST_ASSERT_EQUAL(0, config.set_rate(limit));
+}
+
+static void test_fewer_channels_raise_the_limit_again()
+{
+    static Acquisition acquisition;
+    CostSource source;
+    SamplerConfig config(source, acquisition);
+    TEST_ASSERT_TRUE(source.set_pins(PINS, 4));
+    TEST_ASSERT_TRUE(source.begin(&acquisition, 1000));
+    source.measure(4 * 8000);
+    TEST_ASSERT_EQUAL(3750, config.max_rate_hz());
+    TEST_ASSERT_EQUAL(-1, config.set_rate(10000));
+
+    // One channel: the four channel cost no longer applies, first the estimate, then the measurement
+    source.end();
+    TEST_ASSERT_TRUE(source.set_pins(PINS, 1));
+    TEST_ASSERT_TRUE(source.begin(&acquisition, 1000));
+    TEST_ASSERT_EQUAL(BUDGET_CYCLES / SampleSource::DEFAULT_CYCLES_PER_CHANNEL, config.max_rate_hz());
+    source.measure(8000);
+    TEST_ASSERT_EQUAL(15000, config.max_rate_hz());
+    TEST_ASSERT_EQUAL(0, config.set_rate(10000));
+    TEST_ASSERT_EQUAL(10000, config.rate());
+}
+
+static void test_rate_change_starts_the_measurement_over()
+{
+    static Acquisition acquisition;
+    CostSource source;
+    SamplerConfig config(source, acquisition);
+    TEST_ASSERT_TRUE(source.set_pins(PINS, 1));
+    TEST_ASSERT_TRUE(source.begin(&acquisition, 1000));
+
+    // Worst case within a config, a slow frame keeps the limit down until the config changes
+    source.measure(8000);
+    source.measure(24000);
+    source.measure(8000);
+    TEST_ASSERT_EQUAL(5000, config.max_rate_hz());
+    TEST_ASSERT_EQUAL(0, config.set_rate(2000));
+    TEST_ASSERT_FALSE(source.cost_measured());
+    source.measure(8000);
+    TEST_ASSERT_EQUAL(15000, config.max_rate_hz());
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unmeasured_cost_is_an_estimate);
+    RUN_TEST(test_fewer_channels_raise_the_limit_again);
+    RUN_TEST(test_rate_change_starts_the_measurement_over);
+    return UNITY_END();
+}
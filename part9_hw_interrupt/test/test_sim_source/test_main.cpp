@@ -0,0 +1,147 @@
+/*
+Host tests for SimulatedSource: recordings replay with their own channel count and wrap around, the
+virtual clock advances one period per frame, and the synthetic waveform stays within the ADC range.
+*/
+
+#include <unity.h>
+#include "sim_source.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Keeps every delivered frame
+class CaptureSink : public SampleSink
+{
+public:
+    static const size_t MAX_SAMPLES = 4096;
+
+    void on_frames(const sample_t* frames, size_t frame_cnt, uint8_t channels, uint64_t timestamp_us,
+        uint32_t period_ns) override
+    {
+        if (calls == 0)
+        {
+            first_us = timestamp_us;
+        }
+        last_us = timestamp_us;
+        last_cnt = frame_cnt;
+        this->channels = channels;
+        this->period_ns = period_ns;
+        for (size_t i = 0; i < frame_cnt * channels && len < MAX_SAMPLES; i++)
+        {
+            samples[len++] = frames[i];
+        }
+        calls++;
+    }
+
+    sample_t samples[MAX_SAMPLES];
+    size_t len = 0;
+    size_t calls = 0;
+    size_t last_cnt = 0;
+    uint8_t channels = 0;
+    uint32_t period_ns = 0;
+    uint64_t first_us = 0;
+    uint64_t last_us = 0;
+};
+
+static const sample_t recording[] = {
+    10, 11, 12,
+    20, 21, 22,
+    30, 31, 32,
+    40, 41, 42,
+    50, 51, 52,
+};
+static const size_t RECORDING_FRAMES = 5;
+static const int pins[SAMPLE_MAX_CHANNELS] = {};
+
+static void test_recording_sets_channel_count()
+{
+    SimulatedSource src(recording, RECORDING_FRAMES, 3);
+    TEST_ASSERT_EQUAL(3, src.channels());
+    TEST_ASSERT_EQUAL(3, src.max_channels());
+    TEST_ASSERT_FALSE(src.set_pins(pins, 4)); // would read past the end of each recorded frame
+
+    CaptureSink sink;
+    TEST_ASSERT_TRUE(src.set_pins(pins, 2));
+    TEST_ASSERT_FALSE(src.begin(&sink, 1000)); // fewer channels would replay the frames misaligned
+    TEST_ASSERT_TRUE(src.set_pins(pins, 3));
+    TEST_ASSERT_TRUE(src.begin(&sink, 1000));
+}
+
+static void test_recording_replays_in_a_loop()
+{
+    SimulatedSource src(recording, RECORDING_FRAMES, 3);
+    CaptureSink sink;
+    TEST_ASSERT_TRUE(src.begin(&sink, 1000));
+    TEST_ASSERT_EQUAL(12, src.pump(12));
+    TEST_ASSERT_EQUAL(3, sink.channels);
+    TEST_ASSERT_EQUAL(36, sink.len);
+    for (size_t f = 0; f < 12; f++)
+    {
+        for (size_t c = 0; c < 3; c++)
+        {
+            TEST_ASSERT_EQUAL(recording[(f % RECORDING_FRAMES) * 3 + c], sink.samples[f * 3 + c]);
+        }
+    }
+}
+
+static void test_bad_recordings_are_refused()
+{
+    CaptureSink sink;
+    SimulatedSource empty(recording, 0, 3);
+    TEST_ASSERT_FALSE(empty.begin(&sink, 1000));
+    SimulatedSource no_channels(recording, RECORDING_FRAMES, 0);
+    TEST_ASSERT_FALSE(no_channels.begin(&sink, 1000));
+    SimulatedSource too_wide(recording, 1, SAMPLE_MAX_CHANNELS + 1);
+    TEST_ASSERT_FALSE(too_wide.begin(&sink, 1000));
+}
+
+static void test_virtual_clock()
+{
+    SimulatedSource src(SimWaveform{2048.f, 1000.f, 5.f, 0.f});
+    CaptureSink sink;
+    TEST_ASSERT_TRUE(src.begin(&sink, 1000));
+    // Delivered in CHUNK_LEN pieces, each stamped with the time of its first frame
+    TEST_ASSERT_EQUAL(200, src.pump(200));
+    TEST_ASSERT_EQUAL(4, sink.calls);
+    TEST_ASSERT_EQUAL(1000000, sink.period_ns);
+    TEST_ASSERT_EQUAL(0, sink.first_us);
+    TEST_ASSERT_EQUAL(3 * SimulatedSource::CHUNK_LEN * 1000, sink.last_us);
+    TEST_ASSERT_EQUAL(200 - 3 * SimulatedSource::CHUNK_LEN, sink.last_cnt);
+}
+
+static void test_waveform_is_clamped_and_repeatable()
+{
+    // Amplitude beyond full scale must clip like the converter, not wrap
+    SimulatedSource a(SimWaveform{2048.f, 3000.f, 50.f, 100.f});
+    SimulatedSource b(SimWaveform{2048.f, 3000.f, 50.f, 100.f});
+    CaptureSink sa;
+    CaptureSink sb;
+    TEST_ASSERT_TRUE(a.set_pins(pins, 2));
+    TEST_ASSERT_TRUE(b.set_pins(pins, 2));
+    TEST_ASSERT_TRUE(a.begin(&sa, 1000));
+    TEST_ASSERT_TRUE(b.begin(&sb, 1000));
+    a.pump(1000);
+    b.pump(1000);
+    bool clipped_low = false;
+    bool clipped_high = false;
+    for (size_t i = 0; i < sa.len; i++)
+    {
+        TEST_ASSERT_LESS_OR_EQUAL(SimulatedSource::ADC_MAX, sa.samples[i]);
+        clipped_low = clipped_low || sa.samples[i] == 0;
+        clipped_high = clipped_high || sa.samples[i] == SimulatedSource::ADC_MAX;
+    }
+    TEST_ASSERT_TRUE(clipped_low && clipped_high);
+    TEST_ASSERT_EQUAL(sa.len, sb.len);
+    TEST_ASSERT_EQUAL_MEMORY(sa.samples, sb.samples, sa.len * sizeof(sample_t));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_recording_sets_channel_count);
+    RUN_TEST(test_recording_replays_in_a_loop);
+    RUN_TEST(test_bad_recordings_are_refused);
+    RUN_TEST(test_virtual_clock);
+    RUN_TEST(test_waveform_is_clamped_and_repeatable);
+    return UNITY_END();
+}
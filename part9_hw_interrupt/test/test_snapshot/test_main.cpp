@@ -0,0 +1,120 @@
+/*
+Host tests for Snapshot: values survive the word-by-word copy (a partial last word included), and under
+a writer publishing as fast as it can, readers only ever see whole values from one publish() with
+generations that never go backwards.
+*/
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <unity.h>
+#include "snapshot.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 13 bytes, the last word of the copy is partial
+struct Odd
+{
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint8_t d;
+};
+
+// Every field carries the same stamp, so a torn read shows up as a mismatch
+struct Stamped
+{
+    uint32_t stamp[64];
+    uint64_t stamp64;
+};
+
+static void test_round_trip()
+{
+    Snapshot<Odd> snap;
+    Odd value;
+    TEST_ASSERT_EQUAL(0, snap.read(&value)); // never published, zeroed
+    TEST_ASSERT_EQUAL(0, value.a);
+    TEST_ASSERT_EQUAL(0, value.d);
+
+    for (uint32_t i = 1; i <= 5; i++)
+    {
+        snap.publish(Odd{i, i * 10, i * 100, (uint8_t)(200 + i)});
+        TEST_ASSERT_EQUAL(i, snap.read(&value));
+        TEST_ASSERT_EQUAL(i, value.a);
+        TEST_ASSERT_EQUAL(i * 10, value.b);
+        TEST_ASSERT_EQUAL(i * 100, value.c);
+        TEST_ASSERT_EQUAL(200 + i, value.d);
+    }
+    TEST_ASSERT_EQUAL(5, snap.generation());
+}
+
+static void test_no_torn_reads()
+{
+    static const uint32_t PUBLISHES = 200000;
+    static Snapshot<Stamped> snap;
+    std::atomic<bool> done{false};
+
+    std::thread writer([&]() {
+        Stamped value;
+        for (uint32_t g = 1; g <= PUBLISHES; g++)
+        {
+            for (uint32_t& word : value.stamp)
+            {
+                word = g;
+            }
+            value.stamp64 = (uint64_t)g << 32 | g;
+            snap.publish(value);
+            if (g % 64 == 0)
+            {
+                std::this_thread::yield(); // let the readers in on a single core too
+            }
+        }
+        done.store(true);
+    });
+
+    // Two readers like the CLI and a second task, on whatever cores the host gives them
+    std::atomic<uint32_t> torn{0};
+    std::atomic<uint32_t> backwards{0};
+    std::atomic<uint32_t> reads{0};
+    auto reader = [&]() {
+        Stamped value;
+        uint32_t last = 0;
+        while (!done.load())
+        {
+            const uint32_t gen = snap.read(&value);
+            const uint32_t stamp = value.stamp[0];
+            bool whole = value.stamp64 == ((uint64_t)stamp << 32 | stamp) && stamp == gen;
+            for (uint32_t word : value.stamp)
+            {
+                whole = whole && word == stamp;
+            }
+            torn += !whole;
+            backwards += gen < last;
+            last = gen;
+            reads++;
+            std::this_thread::yield();
+        }
+    };
+    std::thread reader1(reader);
+    std::thread reader2(reader);
+    writer.join();
+    reader1.join();
+    reader2.join();
+
+    TEST_ASSERT_EQUAL(0, torn.load());
+    TEST_ASSERT_EQUAL(0, backwards.load());
+    TEST_ASSERT_GREATER_THAN(0, reads.load());
+    TEST_ASSERT_EQUAL(PUBLISHES, snap.generation());
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%u reads during %u publishes", (unsigned)reads.load(), (unsigned)PUBLISHES);
+    TEST_MESSAGE(msg);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_no_torn_reads);
+    return UNITY_END();
+}
@@ -0,0 +1,97 @@
+/*
+Host tests for SpectrumAnalyzer: a sine comes out as a peak at its frequency with its amplitude, and
+size 0 keeps the stage off until a size is set.
+*/
+
+#include <math.h>
+#include <unity.h>
+#include "spectrum.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const double PI = 3.14159265358979323846;
+
+// 256 frames of two channels at 1 kHz, a sine of amplitude on channel 1 only
+static void fill_block(SampleBlock& block, uint32_t first_frame, double freq_hz, double amplitude)
+{
+    block.reset();
+    block.channels = 2;
+    block.period_ns = 1000000;
+    block.t0_us = first_frame * 1000ull;
+    for (uint16_t f = 0; f < 256; f++)
+    {
+        const double t = (first_frame + f) / 1000.0;
+        block.samples[2 * f] = 2048;
+        block.samples[2 * f + 1] = (sample_t)lround(2048.0 + amplitude * sin(2 * PI * freq_hz * t));
+        block.jitter_us[f] = 0;
+    }
+    block.len = 512;
+}
+
+static void test_config_checks()
+{
+    SpectrumAnalyzer spectrum(1024);
+    TEST_ASSERT_EQUAL(1024, spectrum.size());
+    TEST_ASSERT_EQUAL(0, spectrum.set_config(0, FftWindow::Hann, 0));
+    TEST_ASSERT_EQUAL(0, spectrum.set_config(SpectrumAnalyzer::MIN_SIZE, FftWindow::Hamming, 7));
+    TEST_ASSERT_EQUAL(0, spectrum.set_config(SpectrumAnalyzer::MAX_SIZE, FftWindow::Hann, 0));
+    TEST_ASSERT_EQUAL(-1, spectrum.set_config(SpectrumAnalyzer::MIN_SIZE / 2, FftWindow::Hann, 0));
+    TEST_ASSERT_EQUAL(-1, spectrum.set_config(SpectrumAnalyzer::MAX_SIZE * 2, FftWindow::Hann, 0));
+    TEST_ASSERT_EQUAL(-1, spectrum.set_config(1000, FftWindow::Hann, 0));
+    TEST_ASSERT_EQUAL(-1, spectrum.set_config(256, FftWindow::Hann, SAMPLE_MAX_CHANNELS));
+}
+
+static void test_sine_peak()
+{
+    static SpectrumAnalyzer spectrum(0);
+    static SampleBlock block;
+    TEST_ASSERT_EQUAL(0, spectrum.set_config(1024, FftWindow::Hann, 1));
+
+    for (uint32_t f = 0; f < 4 * 1024; f += 256)
+    {
+        fill_block(block, f, 62.5, 1000.0); // exactly on bin 64
+        spectrum.push_block(block);
+    }
+    TEST_ASSERT_EQUAL(4, spectrum.frame_count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1000.0f / 1024, spectrum.bin_hz());
+    TEST_ASSERT_GREATER_OR_EQUAL(1, spectrum.peak_count());
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 62.5f, spectrum.peak(0).freq_hz);
+    TEST_ASSERT_FLOAT_WITHIN(5.f, 1000.f, spectrum.peak(0).magnitude);
+}
+
+static void test_size_zero_is_off()
+{
+    static SpectrumAnalyzer spectrum(0);
+    static SampleBlock block;
+    for (uint32_t f = 0; f < 4 * 1024; f += 256)
+    {
+        fill_block(block, f, 62.5, 1000.0);
+        spectrum.push_block(block);
+    }
+    TEST_ASSERT_EQUAL(0, spectrum.size());
+    TEST_ASSERT_EQUAL(0, spectrum.frame_count());
+    TEST_ASSERT_EQUAL(0, spectrum.peak_count());
+
+    // Turned on, it starts collecting from the next block
+    TEST_ASSERT_EQUAL(0, spectrum.set_config(256, FftWindow::Hann, 1));
+    fill_block(block, 4096, 62.5, 1000.0);
+    spectrum.push_block(block);
+    TEST_ASSERT_EQUAL(1, spectrum.frame_count());
+
+    // And off again, the next block restarts and computes nothing
+    TEST_ASSERT_EQUAL(0, spectrum.set_config(0, FftWindow::Hann, 1));
+    fill_block(block, 4352, 62.5, 1000.0);
+    spectrum.push_block(block);
+    TEST_ASSERT_EQUAL(0, spectrum.frame_count());
+    TEST_ASSERT_EQUAL(0, spectrum.peak_count());
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_config_checks);
+    RUN_TEST(test_sine_peak);
+    RUN_TEST(test_size_zero_is_off);
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+/*
+Host tests for window_stats() against a two-pass double reference, for every channel count.
+
+Also: a constant window has a variance of exactly 0 however large the offset (where the naive float
+formula cancels catastrophically), full-scale windows do not overflow, the fraction bits scale the
+results back to ADC counts, metrics left out of the mask are not accumulated, and a filter offset is
+taken off min, max, mean and RMS.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+#include "window_stats.h"
+
+void setUp() {}
+void tearDown() {}
+
+static SampleBlock block;
+
+static void fill_block(uint8_t channels, uint32_t seed, sample_t base, uint32_t spread)
+{
+    block.reset();
+    block.channels = channels;
+    block.len = SAMPLE_BLOCK_MAX / channels * channels;
+    for (uint16_t i = 0; i < block.len; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        block.samples[i] = base + (spread ? (seed >> 8) % spread : 0);
+    }
+}
+
+static void test_matches_reference()
+{
+    for (uint8_t channels = 1; channels <= SAMPLE_MAX_CHANNELS; channels++)
+    {
+        fill_block(channels, channels, 1000, 3000);
+        ChannelStats stats[SAMPLE_MAX_CHANNELS];
+        window_stats<STAT_ALL>(block, stats);
+
+        const uint16_t frames = block.frames();
+        for (uint8_t c = 0; c < channels; c++)
+        {
+            double sum = 0.0;
+            double sum_sq = 0.0;
+            sample_t lo = UINT16_MAX;
+            sample_t hi = 0;
+            for (uint16_t f = 0; f < frames; f++)
+            {
+                const sample_t s = block.samples[f * channels + c];
+                sum += s;
+                sum_sq += (double)s * s;
+                lo = s < lo ? s : lo;
+                hi = s > hi ? s : hi;
+            }
+            const double mean = sum / frames;
+            double var = 0.0;
+            for (uint16_t f = 0; f < frames; f++)
+            {
+                const double d = block.samples[f * channels + c] - mean;
+                var += d * d;
+            }
+            var /= frames;
+
+            char msg[32];
+            snprintf(msg, sizeof(msg), "%u channels, ch%u", channels, c);
+            TEST_ASSERT_EQUAL_MESSAGE(frames, stats[c].count, msg);
+            TEST_ASSERT_EQUAL_MESSAGE(lo, stats[c].min, msg);
+            TEST_ASSERT_EQUAL_MESSAGE(hi, stats[c].max, msg);
+            TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-6 * mean, mean, stats[c].mean(), msg);
+            TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-5 * var, var, stats[c].variance(), msg);
+            TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-5 * sqrt(var), sqrt(var), stats[c].stddev(), msg);
+            TEST_ASSERT_FLOAT_WITHIN_MESSAGE(1e-5 * sqrt(sum_sq / frames), sqrt(sum_sq / frames), stats[c].rms(), msg);
+        }
+    }
+}
+
+static void test_constant_window_has_zero_variance()
+{
+    // Constant 60000: in float, sum_sq / n - mean^2 subtracts two values near 3.6e9 and leaves rounding noise
+    ChannelStats stats[1];
+    fill_block(1, 1, 60000, 0);
+    window_stats<STAT_ALL>(block, stats);
+    TEST_ASSERT_EQUAL_FLOAT(0.f, stats[0].variance());
+    TEST_ASSERT_EQUAL_FLOAT(60000.f, stats[0].mean());
+
+    fill_block(1, 1, 60000, 2); // 60000 or 60001
+    window_stats<STAT_ALL>(block, stats);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.25f, stats[0].variance());
+}
+
+static void test_full_scale()
+{
+    ChannelStats stats[1];
+    fill_block(1, 1, UINT16_MAX, 0);
+    window_stats<STAT_ALL>(block, stats);
+    TEST_ASSERT_EQUAL(SAMPLE_BLOCK_MAX * (uint32_t)UINT16_MAX, stats[0].sum);
+    TEST_ASSERT_EQUAL((uint64_t)SAMPLE_BLOCK_MAX * UINT16_MAX * UINT16_MAX, stats[0].sum_sq);
+    TEST_ASSERT_EQUAL_FLOAT((float)UINT16_MAX, stats[0].rms());
+    TEST_ASSERT_EQUAL_FLOAT(0.f, stats[0].variance());
+}
+
+static void test_frac_bits_and_mask()
+{
+    ChannelStats stats[2];
+    fill_block(2, 5, 4000, 0);
+    block.frac_bits = 3;
+    window_stats<STAT_MIN | STAT_MEAN>(block, stats);
+    TEST_ASSERT_EQUAL_FLOAT(500.f, stats[0].min_counts());
+    TEST_ASSERT_EQUAL_FLOAT(500.f, stats[1].mean());
+    TEST_ASSERT_EQUAL(0, stats[0].max); // not in the mask
+    TEST_ASSERT_EQUAL(0, stats[0].sum_sq);
+}
+
+static void test_filter_offset()
+{
+    // A high-pass output +-100 counts around the mid-scale offset, one fraction bit
+    ChannelStats stats[1];
+    fill_block(1, 1, 0, 0);
+    block.frac_bits = 1;
+    block.offset = 2048 << 1;
+    for (uint16_t i = 0; i < block.len; i++)
+    {
+        block.samples[i] = i % 2 ? block.offset + 200 : block.offset - 200;
+    }
+    window_stats<STAT_ALL>(block, stats);
+    TEST_ASSERT_EQUAL_FLOAT(-100.f, stats[0].min_counts());
+    TEST_ASSERT_EQUAL_FLOAT(100.f, stats[0].max_counts());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.f, stats[0].mean());
+    TEST_ASSERT_EQUAL_FLOAT(100.f, stats[0].rms());
+    TEST_ASSERT_EQUAL_FLOAT(10000.f, stats[0].variance());
+
+    // RMS alone still gets the sum it needs to take the offset off
+    window_stats<STAT_RMS>(block, stats);
+    TEST_ASSERT_EQUAL_FLOAT(100.f, stats[0].rms());
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_constant_window_has_zero_variance);
+    RUN_TEST(test_full_scale);
+    RUN_TEST(test_frac_bits_and_mask);
+    RUN_TEST(test_filter_offset);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+/*
+Host side decoder for the binary block stream (see include/frame_stream.h for the frame layout).
+
+feed() takes raw bytes as they come off the port, splits them at the 0x00 delimiters, undoes the COBS
+encoding and checks length, version and CRC-32. Every good frame is handed to a callback, damaged ones are
+counted and skipped; the decoder resynchronizes at the next 0x00, so CLI text on the same port only costs
+the frame it lands in. Gaps in the sequence numbers count as lost frames (the firmware also uses up a
+number for every frame it drops because the line was busy).
+
+Header only and portable, shared by tools/stream_decoder.cpp and the host tests.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct DecodedFrame
+{
+    uint8_t channels;
+    uint8_t frac_bits;
+    uint32_t seq;
+    uint16_t frames;
+    uint64_t t0_us;
+    uint32_t period_ns;
+    const uint8_t* samples; // frames * channels little endian uint16, interleaved by channel
+
+    uint16_t sample(size_t i) const { return samples[2 * i] | samples[2 * i + 1] << 8; }
+};
+
+struct DecoderTotals
+{
+    uint64_t good;
+    uint64_t bad; // COBS, length, version or CRC errors
+    uint64_t lost; // gaps in the sequence numbers
+    uint64_t samples;
+};
+
+class FrameDecoder
+{
+public:
+    static const uint8_t FRAME_VERSION = 1;
+    static const size_t HEADER_LEN = 24;
+    static const size_t CRC_LEN = 4;
+    static const size_t MAX_FRAME = HEADER_LEN + 2 * 65535 * 8 + CRC_LEN; // larger than any valid frame
+
+    // Same CRC-32 as zlib and the firmware, bit at a time (speed is not a concern on the host)
+    static uint32_t crc32(const uint8_t* data, size_t len)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < len; i++)
+        {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+    // Call on_frame(const DecodedFrame&) for every good frame completed by these bytes. The frame's
+    // samples point into the decoder and are only valid during the call.
+    template <typename OnFrame>
+    void feed(const uint8_t* data, size_t len, OnFrame on_frame)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            if (data[i] != 0)
+            {
+                if (frame_len_ < MAX_FRAME)
+                {
+                    frame_[frame_len_++] = data[i];
+                }
+                else
+                {
+                    overflow_ = true;
+                }
+                continue;
+            }
+
+            // Delimiter: decode what came before it. Opened mid-stream, the first frame is a tail and fails.
+            if (frame_len_ > 0)
+            {
+                const long decoded = overflow_ ? -1 : cobs_decode(frame_, frame_len_);
+                DecodedFrame frame;
+                if (decoded >= 0 && check(frame_, decoded, &frame))
+                {
+                    on_frame(frame);
+                }
+                else
+                {
+                    totals_.bad++;
+                }
+            }
+            frame_len_ = 0;
+            overflow_ = false;
+        }
+    }
+
+    const DecoderTotals& totals() const { return totals_; }
+
+private:
+    static uint64_t read_le(const uint8_t* p, size_t len)
+    {
+        uint64_t v = 0;
+        for (size_t i = 0; i < len; i++)
+        {
+            v |= (uint64_t)p[i] << (8 * i);
+        }
+        return v;
+    }
+
+    // Decode one COBS frame (delimiter already stripped) in place. Returns the decoded length, -1 if
+    // malformed.
+    static long cobs_decode(uint8_t* buf, size_t len)
+    {
+        size_t in = 0;
+        size_t out = 0;
+        while (in < len)
+        {
+            const uint8_t code = buf[in++];
+            if (code == 0 || in + code - 1 > len)
+            {
+                return -1;
+            }
+            for (uint8_t i = 1; i < code; i++)
+            {
+                buf[out++] = buf[in++];
+            }
+            // A group below 0xFF stands for a zero too, except at the end of the frame
+            if (code != 0xFF && in < len)
+            {
+                buf[out++] = 0;
+            }
+        }
+        return out;
+    }
+
+    // Check a decoded frame and fill in out. False if it is damaged.
+    bool check(const uint8_t* frame, size_t len, DecodedFrame* out)
+    {
+        if (len < HEADER_LEN + CRC_LEN || frame[0] != FRAME_VERSION)
+        {
+            return false;
+        }
+        out->channels = frame[1];
+        out->frac_bits = frame[2];
+        out->seq = read_le(&frame[4], 4);
+        out->frames = read_le(&frame[8], 2);
+        out->t0_us = read_le(&frame[12], 8);
+        out->period_ns = read_le(&frame[20], 4);
+        out->samples = &frame[HEADER_LEN];
+        const size_t samples = (size_t)out->frames * out->channels;
+        if (out->channels == 0 || len != HEADER_LEN + 2 * samples + CRC_LEN ||
+            crc32(frame, len - CRC_LEN) != read_le(&frame[len - CRC_LEN], 4))
+        {
+            return false;
+        }
+
+        if (have_seq_ && out->seq != next_seq_)
+        {
+            totals_.lost += (uint32_t)(out->seq - next_seq_);
+        }
+        have_seq_ = true;
+        next_seq_ = out->seq + 1;
+        totals_.good++;
+        totals_.samples += samples;
+        return true;
+    }
+
+    uint8_t frame_[MAX_FRAME];
+    size_t frame_len_ = 0;
+    bool overflow_ = false;
+    bool have_seq_ = false;
+    uint32_t next_seq_ = 0;
+    DecoderTotals totals_ = {};
+};
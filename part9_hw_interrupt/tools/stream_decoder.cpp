@@ -0,0 +1,152 @@
+/*
+Command line decoder for the binary block stream (see include/frame_stream.h for the frame layout).
+
+Reads frames from a serial device (or stdin) through FrameDecoder (frame_decoder.h), which checks them and
+tracks the sequence number, and prints either one summary line per frame or the samples as CSV. A summary
+of good, bad and lost frames goes to stderr at the end (EOF or Ctrl-C).
+
+Linux only (termios). Build and run:
+    g++ -std=c++17 -O2 -Wall -o stream_decoder tools/stream_decoder.cpp
+    ./stream_decoder /dev/ttyUSB0 921600 --csv > samples.csv
+Switch the board over first with "stream on 921600" in the CLI.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "frame_decoder.h"
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int)
+{
+    stop = 1;
+}
+
+static speed_t baud_constant(long baud)
+{
+    switch (baud)
+    {
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 500000: return B500000;
+    case 921600: return B921600;
+    case 1000000: return B1000000;
+    case 1500000: return B1500000;
+    case 2000000: return B2000000;
+    default: return 0;
+    }
+}
+
+// Raw 8N1 at baud, no echo, no line discipline. Returns 0 on success, -1 otherwise.
+static int configure_port(int fd, long baud)
+{
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        return isatty(fd) ? -1 : 0; // pipes and files need no setup
+    }
+    const speed_t speed = baud_constant(baud);
+    if (speed == 0)
+    {
+        fprintf(stderr, "unsupported baud rate %ld\n", baud);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+// Print one good frame
+static void print_frame(const DecodedFrame& frame, bool csv)
+{
+    if (!csv)
+    {
+        printf("seq %u: %u frames x %u channels, t0 %llu us, period %u ns\n", (unsigned)frame.seq,
+            (unsigned)frame.frames, (unsigned)frame.channels, (unsigned long long)frame.t0_us,
+            (unsigned)frame.period_ns);
+        return;
+    }
+
+    const double scale = 1.0 / (1u << frame.frac_bits);
+    size_t i = 0;
+    for (uint16_t f = 0; f < frame.frames; f++)
+    {
+        printf("%.3f", frame.t0_us + (double)f * frame.period_ns / 1000.0);
+        for (uint8_t c = 0; c < frame.channels; c++, i++)
+        {
+            printf(",%g", frame.sample(i) * scale);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <device|-> [baud] [--csv]\n", argv[0]);
+        return 2;
+    }
+
+    long baud = 115200;
+    bool csv = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--csv") == 0)
+        {
+            csv = true;
+        }
+        else
+        {
+            baud = strtol(argv[i], NULL, 10);
+        }
+    }
+
+    const int fd = strcmp(argv[1], "-") == 0 ? STDIN_FILENO : open(argv[1], O_RDONLY | O_NOCTTY);
+    if (fd < 0 || configure_port(fd, baud) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    static FrameDecoder decoder; // holds a frame buffer of 1MB
+    uint8_t buf[4096];
+
+    while (!stop)
+    {
+        const ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        decoder.feed(buf, n, [csv](const DecodedFrame& frame) { print_frame(frame, csv); });
+    }
+
+    fflush(stdout);
+    const DecoderTotals& totals = decoder.totals();
+    fprintf(stderr, "%llu good frames, %llu bad, %llu lost, %llu samples\n", (unsigned long long)totals.good,
+        (unsigned long long)totals.bad, (unsigned long long)totals.lost, (unsigned long long)totals.samples);
+    return 0;
+}